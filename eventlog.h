@@ -0,0 +1,53 @@
+#ifndef EVENTLOG_H
+#define EVENTLOG_H
+
+#include <stdint.h>
+
+// Binary event log written by solution.c and read back by logdecode.c.
+// The file is a LogFileHeader followed by fixed-size LogRecords.
+
+#define LOG_MAGIC "TRKLOG1"
+
+// Compile-time levels: build with -DLOG_LEVEL=... to choose what is recorded.
+#define LOG_LEVEL_NONE  0   // nothing, logging calls compile away
+#define LOG_LEVEL_INFO  1   // turns, arrivals, unassignable packages
+#define LOG_LEVEL_DEBUG 2   // per-truck state and move decisions every turn
+
+#define LOG_ARGS        6
+#define LOG_CHUNK_IDS   5   // package ids carried by one EV_ID_CHUNK
+
+typedef enum {
+    EV_TURN = 1,        // a = {newPackageRequestCount}
+    EV_NEW_PACKAGE,     // a = {packageId, pickup_x, pickup_y, dropoff_x, dropoff_y}
+    EV_NO_TRUCK,        // a = {packageId}
+    EV_TRUCK_STATE,     // truck, a = {x, y, currentPackageCount}
+    EV_ASSIGN_SUMMARY,  // truck, a = {onboard, assigned}; assigned ids follow as chunks
+    EV_MOVES_BEGIN,     // start of the per-truck movement decisions
+    EV_MOVE,            // truck, a = {x, y, move, pickUp, dropOff}
+    EV_ID_LIST,         // truck, a = {kind, count}; ids follow as chunks
+    EV_ID_CHUNK,        // a = {n, id0 .. id4}
+    EV_DROPPED,         // a = {records lost because the ring was full}
+    EV_ROLLOUT,         // a = {chosen route policy, projected expired, projected delivered}
+    EV_RELAY,           // truck, a = {packageId, transfer x, transfer y}: dropped for the next leg
+    EV_RELAXED,         // truck, a = {packageId, load}: placed by the relaxed fallback
+    EV_LIST_FULL,       // truck, a = {packageId}: assigned list full, re-queued
+} LogEventType;
+
+// EV_ID_LIST kinds
+#define LOG_LIST_ONBOARD  0
+#define LOG_LIST_ASSIGNED 1
+
+typedef struct LogFileHeader {
+    char magic[8];
+    uint32_t recordSize;
+    uint32_t reserved;
+} LogFileHeader;
+
+typedef struct LogRecord {
+    uint16_t type;
+    int16_t truck;      // -1 when not about a truck
+    int32_t turn;
+    int32_t a[LOG_ARGS];
+} LogRecord;
+
+#endif // EVENTLOG_H
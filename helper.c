@@ -1,31 +1,441 @@
+#define _GNU_SOURCE // cpu_set_t, gettid
 #include "helper.h"
 #include <stdbool.h>
+#include <dirent.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <limits.h>
+#include <sched.h>
+#include <signal.h>
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
 
 struct timeval start, stop;
 
 char currentAuthStrings[MAX_TRUCKS][TRUCK_MAX_CAP + 1];
+unsigned long long currentPackedAuth[MAX_TRUCKS]; // packAuthString of the above
 int turnNumber = 0;
 
+// Socket backend state: each solver is owned by exactly one worker, so
+// solverTargets[i] is only ever touched by that worker.
+int solverSockets[MAX_SOLVERS];
+int solverTargets[MAX_SOLVERS];
+int poolStopFd = -1;
+
+// Everything that outlives the helper unless removed. Tracked so that any
+// exit path, including exit(1) and SIGINT/SIGTERM, tears it down.
+pid_t ipcOwnerPid;
+pid_t studentPid = -1;
+int ipcShmId = -1;
+int ipcMainMsgId = -1;
+int ipcSolverMsgIds[MAX_SOLVERS];
+int ipcSolverCount = 0;
+
+SolverStats solverStats[MAX_SOLVERS];
+
+static unsigned long monotonicNs(void) {
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (unsigned long)now.tv_sec * 1000000000UL + now.tv_nsec;
+}
+
+static void addStat(atomic_ulong* counter, unsigned long amount) {
+    atomic_fetch_add_explicit(counter, amount, memory_order_relaxed);
+}
+
+static unsigned long readStat(atomic_ulong* counter) {
+    return atomic_load_explicit(counter, memory_order_relaxed);
+}
+
+// One line per student turn: what the solvers did since the last one and
+// the solver that served the largest share of the guesses.
+static void reportSolverTurn(FILE* file, int turn, int S) {
+    static unsigned long lastGuesses[MAX_SOLVERS], lastRetargets[MAX_SOLVERS], lastHits[MAX_SOLVERS];
+    static unsigned long lastBusyNs[MAX_SOLVERS];
+    unsigned long guesses = 0, retargets = 0, hits = 0, busyNs = 0, top = 0;
+    int topSolver = 0;
+
+    for (int i = 0; i < S; i++) {
+        unsigned long g = readStat(&solverStats[i].guesses), r = readStat(&solverStats[i].retargets);
+        unsigned long h = readStat(&solverStats[i].hits), b = readStat(&solverStats[i].busyNs);
+        if (g - lastGuesses[i] > top) {
+            top = g - lastGuesses[i];
+            topSolver = i;
+        }
+        guesses += g - lastGuesses[i];
+        retargets += r - lastRetargets[i];
+        hits += h - lastHits[i];
+        busyNs += b - lastBusyNs[i];
+        lastGuesses[i] = g;
+        lastRetargets[i] = r;
+        lastHits[i] = h;
+        lastBusyNs[i] = b;
+    }
+    fprintf(file, "turn %d: guesses %lu retargets %lu hits %lu busy %.3f ms busiest solver %d (%.0f%% of guesses)\n",
+            turn, guesses, retargets, hits, busyNs / 1e6, topSolver, guesses ? 100.0 * top / guesses : 0.0);
+}
+
+static void reportSolverExit(FILE* file, int S, SolverPoolWorker workers[], int workerCount) {
+    fprintf(file, "\n%-6s %10s %10s %8s %10s %10s %6s %9s %9s\n",
+            "solver", "guesses", "retargets", "hits", "busy ms", "idle ms", "util", "qnum avg", "qnum max");
+    for (int i = 0; i < S; i++) {
+        SolverStats* stats = &solverStats[i];
+        unsigned long busy = readStat(&stats->busyNs), idle = readStat(&stats->idleNs);
+        unsigned long samples = readStat(&stats->qnumSamples);
+        fprintf(file, "%-6d %10lu %10lu %8lu %10.1f ", i,
+                readStat(&stats->guesses), readStat(&stats->retargets), readStat(&stats->hits), busy / 1e6);
+        if (workerCount > 0) {
+            // Pool workers share their idle time and have no queue to sample.
+            fprintf(file, "%10s %6s %9s %9s\n", "-", "-", "-", "-");
+            continue;
+        }
+        fprintf(file, "%10.1f %5.1f%% %9.2f %9lu\n", idle / 1e6, busy + idle ? 100.0 * busy / (busy + idle) : 0.0,
+                samples ? (double)readStat(&stats->qnumTotal) / samples : 0.0, readStat(&stats->qnumMax));
+    }
+    for (int w = 0; w < workerCount; w++) {
+        fprintf(file, "pool worker %d: idle %.1f ms\n", w, readStat(&workers[w].idleNs) / 1e6);
+    }
+}
+
+// --- CPU Placement ---
+
+typedef struct CpuPlacement {
+    bool report;        // print migrations at exit
+    bool pin;
+    cpu_set_t helper, solution, solvers;
+    char domain[64];    // where the automatic sets came from
+} CpuPlacement;
+
+// "0-3,8" -> set. Returns -1 on a malformed or empty list.
+static int parseCpuList(const char* text, cpu_set_t* set) {
+    CPU_ZERO(set);
+    while (*text != '\0' && *text != '\n') {
+        char* end;
+        long lo = strtol(text, &end, 10), hi = lo;
+        if (end == text || lo < 0) return -1;
+        if (*end == '-') {
+            text = end + 1;
+            hi = strtol(text, &end, 10);
+            if (end == text || hi < lo) return -1;
+        }
+        for (long cpu = lo; cpu <= hi && cpu < CPU_SETSIZE; cpu++) CPU_SET(cpu, set);
+        text = end;
+        if (*text == ',') text++;
+        else if (*text != '\0' && *text != '\n') return -1;
+    }
+    return CPU_COUNT(set) > 0 ? 0 : -1;
+}
+
+static int readCpuListFile(const char* path, cpu_set_t* set) {
+    char text[4096];
+    FILE* file = fopen(path, "r");
+    if (file == NULL) return -1;
+    bool read = fgets(text, sizeof(text), file) != NULL;
+    fclose(file);
+    return read ? parseCpuList(text, set) : -1;
+}
+
+static void formatCpuSet(const cpu_set_t* set, char* out, size_t size) {
+    size_t used = 0;
+    out[0] = '\0';
+    for (int cpu = 0; cpu < CPU_SETSIZE && used < size; cpu++) {
+        if (!CPU_ISSET(cpu, set)) continue;
+        int last = cpu;
+        while (last + 1 < CPU_SETSIZE && CPU_ISSET(last + 1, set)) last++;
+        used += snprintf(out + used, size - used, last > cpu ? "%s%d-%d" : "%s%d", used ? "," : "", cpu, last);
+        cpu = last;
+    }
+}
+
+// CPUs sharing the deepest cache of cpu; returns that cache level or -1.
+static int lastLevelCacheOf(int cpu, cpu_set_t* set) {
+    int best = -1;
+    for (int index = 0; ; index++) {
+        char path[128];
+        int level;
+        snprintf(path, sizeof(path), "/sys/devices/system/cpu/cpu%d/cache/index%d/level", cpu, index);
+        FILE* file = fopen(path, "r");
+        if (file == NULL) break;
+        bool read = fscanf(file, "%d", &level) == 1;
+        fclose(file);
+        if (!read || level <= best) continue;
+
+        cpu_set_t shared;
+        snprintf(path, sizeof(path), "/sys/devices/system/cpu/cpu%d/cache/index%d/shared_cpu_list", cpu, index);
+        if (readCpuListFile(path, &shared) == 0) {
+            *set = shared;
+            best = level;
+        }
+    }
+    return best;
+}
+
+// CPUs of the NUMA node holding cpu; returns the node or -1.
+static int numaNodeOf(int cpu, cpu_set_t* set) {
+    for (int node = 0; ; node++) {
+        char path[128];
+        snprintf(path, sizeof(path), "/sys/devices/system/node/node%d/cpulist", node);
+        if (readCpuListFile(path, set) == -1) {
+            if (access(path, F_OK) == -1) return -1;
+            continue;
+        }
+        if (CPU_ISSET(cpu, set)) return node;
+    }
+}
+
+// Reads the environment and fills in the three sets. The automatic split
+// gives the turn loop the first CPU of the domain and the solution the
+// first half of the rest. Solvers get the other half plus the turn loop's
+// CPU, which is idle while the solution (and so the solvers) run. Returns -1
+// on a bad setting.
+static int initCpuPlacement(CpuPlacement* placement) {
+    const char* mode = getenv(CPU_PLACEMENT_ENV);
+    const char* helperCpus = getenv(HELPER_CPUS_ENV);
+    const char* solutionCpus = getenv(SOLUTION_CPUS_ENV);
+    const char* solverCpus = getenv(SOLVER_CPUS_ENV);
+    if (mode != NULL && strcmp(mode, "auto") != 0 && strcmp(mode, "report") != 0) return -1;
+
+    placement->pin = (mode != NULL && strcmp(mode, "auto") == 0) ||
+                     helperCpus != NULL || solutionCpus != NULL || solverCpus != NULL;
+    placement->report = placement->pin || mode != NULL;
+    if (!placement->pin) return 0;
+
+    cpu_set_t allowed, domain;
+    if (sched_getaffinity(0, sizeof(allowed), &allowed) == -1) return -1;
+    int cpu = sched_getcpu();
+    if (cpu < 0 || !CPU_ISSET(cpu, &allowed)) {
+        for (cpu = 0; !CPU_ISSET(cpu, &allowed); cpu++);
+    }
+
+    int level = lastLevelCacheOf(cpu, &domain), node;
+    if (level >= 0) {
+        snprintf(placement->domain, sizeof(placement->domain), "L%d cache of cpu %d", level, cpu);
+    } else if ((node = numaNodeOf(cpu, &domain)) >= 0) {
+        snprintf(placement->domain, sizeof(placement->domain), "NUMA node %d", node);
+    } else {
+        domain = allowed;
+        snprintf(placement->domain, sizeof(placement->domain), "all allowed cpus");
+    }
+    CPU_AND(&domain, &domain, &allowed);
+    if (CPU_COUNT(&domain) == 0) domain = allowed;
+
+    int cpus[CPU_SETSIZE], count = 0;
+    for (int c = 0; c < CPU_SETSIZE; c++) {
+        if (CPU_ISSET(c, &domain)) cpus[count++] = c;
+    }
+    int half = count / 2 > 0 ? count / 2 : 1;
+    CPU_ZERO(&placement->helper);
+    CPU_ZERO(&placement->solution);
+    CPU_ZERO(&placement->solvers);
+    CPU_SET(cpus[0], &placement->helper);
+    CPU_SET(cpus[0], &placement->solvers);
+    for (int i = 1; i < count; i++) {
+        CPU_SET(cpus[i], i <= half ? &placement->solution : &placement->solvers);
+    }
+    if (count == 1) CPU_SET(cpus[0], &placement->solution);
+
+    if ((helperCpus != NULL && parseCpuList(helperCpus, &placement->helper) == -1) ||
+        (solutionCpus != NULL && parseCpuList(solutionCpus, &placement->solution) == -1) ||
+        (solverCpus != NULL && parseCpuList(solverCpus, &placement->solvers) == -1)) {
+        return -1;
+    }
+    return 0;
+}
+
+static long migrationsOfTask(pid_t pid, pid_t tid) {
+    char path[64], line[256];
+    long migrations = -1;
+    snprintf(path, sizeof(path), "/proc/%d/task/%d/sched", (int)pid, (int)tid);
+    FILE* file = fopen(path, "r");
+    if (file == NULL) return -1;
+    while (fgets(line, sizeof(line), file) != NULL) {
+        char* colon = strchr(line, ':');
+        if (strncmp(line, "se.nr_migrations", 16) == 0 && colon != NULL) {
+            migrations = atol(colon + 1);
+            break;
+        }
+    }
+    fclose(file);
+    return migrations;
+}
+
+// Sum over every thread of pid, or -1 if the kernel does not say.
+static long migrationsOfProcess(pid_t pid) {
+    char path[64];
+    snprintf(path, sizeof(path), "/proc/%d/task", (int)pid);
+    DIR* tasks = opendir(path);
+    if (tasks == NULL) return -1;
+    long total = -1;
+    struct dirent* entry;
+    while ((entry = readdir(tasks)) != NULL) {
+        if (entry->d_name[0] == '.') continue;
+        long migrations = migrationsOfTask(pid, atoi(entry->d_name));
+        if (migrations >= 0) total = (total < 0 ? 0 : total) + migrations;
+    }
+    closedir(tasks);
+    return total;
+}
+
+void removeIpcObjects(void) {
+    if (getpid() != ipcOwnerPid) return; // forked children must not clean up
+    if (studentPid > 0) {
+        kill(studentPid, SIGKILL);
+        waitpid(studentPid, NULL, 0);
+        studentPid = -1;
+    }
+    if (ipcMainMsgId != -1) msgctl(ipcMainMsgId, IPC_RMID, NULL);
+    for (int i = 0; i < ipcSolverCount; i++) {
+        if (ipcSolverMsgIds[i] != -1) msgctl(ipcSolverMsgIds[i], IPC_RMID, NULL);
+    }
+    if (ipcShmId != -1) shmctl(ipcShmId, IPC_RMID, NULL);
+    ipcMainMsgId = ipcShmId = -1;
+    ipcSolverCount = 0;
+}
+
+void handleTerminationSignal(int signalNumber) {
+    removeIpcObjects();
+    signal(signalNumber, SIG_DFL);
+    raise(signalNumber);
+}
+
+// Soak runs end at the next turn boundary on the first SIGINT/SIGTERM, so
+// the final report still gets printed; a second one tears down at once.
+static volatile sig_atomic_t soakStopRequested = 0;
+
+void requestSoakStop(int signalNumber) {
+    if (soakStopRequested) handleTerminationSignal(signalNumber);
+    soakStopRequested = 1;
+}
+
+// Only there to interrupt msgrcv; the turn loop looks at the clock itself.
+static void turnDeadlineAlarm(int signalNumber) {
+    (void)signalNumber;
+}
+
+// Random keys can collide with another helper running on the same machine.
+// IPC_EXCL turns a collision into a retry instead of two runs sharing one
+// queue or segment.
+int createMessageQueue(key_t* key) {
+    while (1) {
+        *key = rand() % CONSTANT;
+        int id = msgget(*key, PERMS | IPC_CREAT | IPC_EXCL);
+        if (id != -1 || errno != EEXIST) return id;
+    }
+}
+
+int createSharedMemory(key_t* key, size_t size) {
+    while (1) {
+        *key = rand() % CONSTANT;
+        int id = shmget(*key, size, PERMS | IPC_CREAT | IPC_EXCL);
+        if (id != -1 || errno != EEXIST) return id;
+    }
+}
+
 int main(int argc, char* argv[]) {
-    srand(time(NULL));
+    // Seed with the pid too, so helpers started in the same second differ.
+    srand(time(NULL) ^ (getpid() << 16));
 
     if (argc < 2) {
         printf("Error: Test case number must be passed as a command line argument.\n");
         exit(1);
     }
 
+    ipcOwnerPid = getpid();
+    atexit(removeIpcObjects);
+    signal(SIGINT, handleTerminationSignal);
+    signal(SIGTERM, handleTerminationSignal);
+    signal(SIGHUP, handleTerminationSignal);
+
     // --- 1. Read Test Case & Parameters ---
+    // "./helper 7" reads testcase7.txt; "./helper -f path" reads any file;
+    // "./helper -g ..." generates the testcase (see WorkloadGenerator);
+    // "./helper -s ..." runs an open-ended soak (see SoakState).
     int N, D, S, T, B, totalRequests;
-    char testcaseFileName[25];
-    sprintf(testcaseFileName, "testcase%s.txt", argv[1]);
+    char testcaseFileName[PATH_MAX];
+    char testcaseLabel[PATH_MAX];
+    FILE* testcaseFile = NULL;
+    WorkloadGenerator generator;
+    static SoakState soak;
+    bool soakMode = strcmp(argv[1], "-s") == 0;
+    bool generated = soakMode || strcmp(argv[1], "-g") == 0;
 
-    FILE* testcaseFile = fopen(testcaseFileName, "r");
-    if (testcaseFile == NULL) {
-        perror("Error opening testcase file in helper");
-        exit(1);
+    if (soakMode) {
+        if (argc < 9 || argc > 11) {
+            printf("Error: usage: -s N D S B rate maxBoothCost seed [turns [reportEvery]]\n");
+            exit(1);
+        }
+        N = atoi(argv[2]);
+        D = atoi(argv[3]);
+        S = atoi(argv[4]);
+        B = atoi(argv[5]);
+        soak.rate = atof(argv[6]);
+        soak.turnLimit = argc > 9 ? atol(argv[9]) : 0;
+        soak.reportEvery = argc > 10 ? atoi(argv[10]) : SOAK_REPORT_EVERY;
+        generator.N = N;
+        generator.B = B;
+        generator.maxBoothCost = atoi(argv[7]);
+        generator.seed = strtoull(argv[8], NULL, 10);
+        if (initSoak(&generator, &soak) == -1) {
+            printf("Error: These parameters cannot generate a soak workload.\n");
+            exit(1);
+        }
+        // The student is told arrivals go on until the last turn.
+        T = soak.turnLimit > 0 && soak.turnLimit < INT_MAX / 2 ? (int)soak.turnLimit : INT_MAX / 2;
+        totalRequests = MAX_TOTAL_PACKAGES; // the id pool
+        snprintf(testcaseLabel, sizeof(testcaseLabel), "soak (rate %g, seed %llu)", soak.rate, generator.seed);
+        signal(SIGINT, requestSoakStop);
+        signal(SIGTERM, requestSoakStop);
+    } else if (generated) {
+        if (argc != 11 && !(argc == 13 && strcmp(argv[11], "-o") == 0)) {
+            printf("Error: usage: -g N D S T B maxNewPerTurn requests maxBoothCost seed [-o dumpfile]\n");
+            exit(1);
+        }
+        N = atoi(argv[2]);
+        D = atoi(argv[3]);
+        S = atoi(argv[4]);
+        T = atoi(argv[5]);
+        B = atoi(argv[6]);
+        totalRequests = atoi(argv[8]);
+        generator.N = N;
+        generator.T = T;
+        generator.B = B;
+        generator.maxNewPerTurn = atoi(argv[7]);
+        generator.requests = totalRequests;
+        generator.maxBoothCost = atoi(argv[9]);
+        generator.seed = strtoull(argv[10], NULL, 10);
+        if (initWorkload(&generator) == -1) {
+            printf("Error: These parameters cannot generate a test case.\n");
+            exit(1);
+        }
+        snprintf(testcaseLabel, sizeof(testcaseLabel), "generated (seed %llu)", generator.seed);
+        if (argc == 13 && dumpWorkload(&generator, argv[12], D, S) != 0) {
+            perror("Error writing generated testcase");
+            exit(1);
+        }
+    } else {
+        if (strcmp(argv[1], "-f") == 0) {
+            if (argc < 3) {
+                printf("Error: -f needs a testcase file path.\n");
+                exit(1);
+            }
+            snprintf(testcaseFileName, sizeof(testcaseFileName), "%s", argv[2]);
+        } else {
+            snprintf(testcaseFileName, sizeof(testcaseFileName), "testcase%s.txt", argv[1]);
+        }
+        snprintf(testcaseLabel, sizeof(testcaseLabel), "%s", (strcmp(argv[1], "-f") == 0) ? argv[2] : argv[1]);
+
+        testcaseFile = fopen(testcaseFileName, "r");
+        if (testcaseFile == NULL) {
+            perror("Error opening testcase file in helper");
+            exit(1);
+        }
+
+        fscanf(testcaseFile, "%d %d %d %d %d %d", &N, &D, &S, &T, &B, &totalRequests);
     }
 
-    fscanf(testcaseFile, "%d %d %d %d %d %d", &N, &D, &S, &T, &B, &totalRequests);
+    // The student binary is ./solution unless SOLUTION_BIN names another.
+    const char* solutionPath = getenv("SOLUTION_BIN");
+    if (solutionPath == NULL) solutionPath = "./solution";
 
     if (N > MAX_GRID_SIZE || D > MAX_TRUCKS || S > MAX_SOLVERS || totalRequests > MAX_TOTAL_PACKAGES) {
         printf("Error: Test case parameters exceed compiled limits.\n");
@@ -33,49 +443,148 @@ int main(int argc, char* argv[]) {
     }
 
     // --- 2. Initialize IPC ---
-    key_t shmKey = rand() % CONSTANT;
+    key_t shmKey;
     int shmId;
     MainSharedMemory* mainShmPtr;
 
     // Create Shared Memory
-    if ((shmId = shmget(shmKey, sizeof(MainSharedMemory), PERMS | IPC_CREAT)) == -1) {
+    if ((shmId = createSharedMemory(&shmKey, sizeof(MainSharedMemory))) == -1) {
         perror("Error in shmget"); exit(1);
     }
+    ipcShmId = shmId;
     if ((mainShmPtr = shmat(shmId, NULL, 0)) == (void*)-1) {
         perror("Error in shmat"); exit(1);
     }
 
+    const char* backend = getenv(SOLVER_BACKEND_ENV);
+    bool socketBackend = false;
+    if (backend != NULL && strcmp(backend, "socket") == 0) {
+        socketBackend = true;
+    } else if (backend != NULL && strcmp(backend, "sysv") != 0) {
+        printf("Error: Unknown %s '%s' (expected sysv or socket).\n", SOLVER_BACKEND_ENV, backend);
+        exit(1);
+    }
+
+    FILE* statsFile = NULL;
+    const char* statsPath = getenv(SOLVER_STATS_ENV);
+    if (statsPath != NULL && (statsFile = fopen(statsPath, "we")) == NULL) {
+        perror("Error opening solver stats file"); exit(1);
+    }
+
+    unsigned long turnDeadlineNs = 0;
+    const char* deadline = getenv(TURN_DEADLINE_ENV);
+    if (deadline != NULL) {
+        double ms = atof(deadline);
+        if (ms <= 0) {
+            printf("Error: %s must be a positive number of milliseconds.\n", TURN_DEADLINE_ENV);
+            exit(1);
+        }
+        turnDeadlineNs = ms * 1e6;
+        signal(SIGALRM, turnDeadlineAlarm);
+    }
+    // Solver threads inherit this mask, so the deadline timer never lands
+    // in one of their msgrcv calls.
+    sigset_t alarmSignal;
+    sigemptyset(&alarmSignal);
+    sigaddset(&alarmSignal, SIGALRM);
+    pthread_sigmask(SIG_BLOCK, &alarmSignal, NULL);
+
+    CpuPlacement placement;
+    if (initCpuPlacement(&placement) == -1) {
+        printf("Error: Bad CPU placement (%s=auto|report, %s/%s/%s=cpu list).\n",
+               CPU_PLACEMENT_ENV, HELPER_CPUS_ENV, SOLUTION_CPUS_ENV, SOLVER_CPUS_ENV);
+        exit(1);
+    }
+    // Solver threads and pool workers inherit this thread's affinity.
+    if (placement.pin && sched_setaffinity(0, sizeof(cpu_set_t), &placement.solvers) == -1) {
+        perror("Error pinning solver threads"); exit(1);
+    }
+
     // Create Solver Threads & Message Queues
     SolverInfo solverInfo[S];
     SolverArguments solverArguments[S];
+    SolverPoolWorker poolWorkers[MAX_SOLVER_WORKERS];
+    int poolWorkerCount = 0;
+    if (socketBackend) {
+        poolWorkerCount = sysconf(_SC_NPROCESSORS_ONLN);
+        const char* workers = getenv(SOLVER_WORKERS_ENV);
+        if (workers != NULL) poolWorkerCount = atoi(workers);
+        if (poolWorkerCount > S) poolWorkerCount = S;
+        if (poolWorkerCount > MAX_SOLVER_WORKERS) poolWorkerCount = MAX_SOLVER_WORKERS;
+        if (poolWorkerCount < 1) poolWorkerCount = 1;
+
+        if ((poolStopFd = eventfd(0, EFD_CLOEXEC)) == -1) {
+            perror("Error in eventfd for solver pool"); exit(1);
+        }
+        for (int w = 0; w < poolWorkerCount; w++) {
+            atomic_init(&poolWorkers[w].idleNs, 0);
+            if ((poolWorkers[w].epollFd = epoll_create1(EPOLL_CLOEXEC)) == -1) {
+                perror("Error in epoll_create1 for solver pool"); exit(1);
+            }
+            struct epoll_event stopEvent = { .events = EPOLLIN, .data.u32 = MAX_SOLVERS };
+            if (epoll_ctl(poolWorkers[w].epollFd, EPOLL_CTL_ADD, poolStopFd, &stopEvent) == -1) {
+                perror("Error in epoll_ctl for solver pool"); exit(1);
+            }
+        }
+    }
     for (int i = 0; i < S; i++) {
-        solverInfo[i].msgKey = rand() % CONSTANT;
-        solverInfo[i].msgId = msgget(solverInfo[i].msgKey, PERMS | IPC_CREAT);
+        if (socketBackend) {
+            // The helper end must not leak into ./solution; the student end must.
+            if (socketpair(AF_UNIX, SOCK_SEQPACKET, 0, solverInfo[i].socketFds) == -1) {
+                perror("Error in socketpair for solver"); exit(1);
+            }
+            fcntl(solverInfo[i].socketFds[0], F_SETFD, FD_CLOEXEC);
+            solverSockets[i] = solverInfo[i].socketFds[0];
+            solverTargets[i] = 0;
+            struct epoll_event event = { .events = EPOLLIN, .data.u32 = i };
+            if (epoll_ctl(poolWorkers[i % poolWorkerCount].epollFd, EPOLL_CTL_ADD, solverSockets[i], &event) == -1) {
+                perror("Error in epoll_ctl for solver"); exit(1);
+            }
+            solverInfo[i].msgKey = solverInfo[i].socketFds[1];
+            solverInfo[i].msgId = -1;
+            continue;
+        }
+        solverInfo[i].msgId = createMessageQueue(&solverInfo[i].msgKey);
         if (solverInfo[i].msgId == -1) {
             perror("Error in msgget for solver"); exit(1);
         }
+        ipcSolverMsgIds[ipcSolverCount++] = solverInfo[i].msgId;
         solverArguments[i].solverNumber = i;
         solverArguments[i].messageQueueKey = solverInfo[i].msgKey;
         if (pthread_create(&solverInfo[i].threadId, NULL, solverRoutine, (void*)&solverArguments[i])) {
             perror("Error in pthread_create for solver"); exit(1);
         }
     }
+    for (int w = 0; w < poolWorkerCount; w++) {
+        if (pthread_create(&poolWorkers[w].threadId, NULL, solverPoolRoutine, (void*)&poolWorkers[w])) {
+            perror("Error in pthread_create for solver pool"); exit(1);
+        }
+    }
+    pthread_sigmask(SIG_UNBLOCK, &alarmSignal, NULL);
+    if (placement.pin && sched_setaffinity(0, sizeof(cpu_set_t), &placement.helper) == -1) {
+        perror("Error pinning the turn loop"); exit(1);
+    }
 
     // Create Main Message Queue (Student <-> Helper)
-    key_t msgKey = rand() % CONSTANT;
+    key_t msgKey;
     int msgId;
-    if ((msgId = msgget(msgKey, PERMS | IPC_CREAT)) == -1) {
+    if ((msgId = createMessageQueue(&msgKey)) == -1) {
         perror("Error in msgget for main queue"); exit(1);
     }
+    ipcMainMsgId = msgId;
 
     // Helper's private grid to store toll info
     int localGrid[MAX_GRID_SIZE][MAX_GRID_SIZE];
 
     // --- 3. Initialize World State ---
+    // Generated packages are filled in on their arrival turn; until then
+    // they sit off the grid.
     PackageInfo packageInfo[totalRequests];
     for (int i = 0; i < totalRequests; i++) {
-        int x1, y1, x2, y2, expiry, arrival;
-        fscanf(testcaseFile, "%d %d %d %d %d %d", &x1, &y1, &x2, &y2, &expiry, &arrival);
+        int x1 = -1, y1 = -1, x2 = -1, y2 = -1, expiry = 0, arrival = 0;
+        if (!generated) {
+            fscanf(testcaseFile, "%d %d %d %d %d %d", &x1, &y1, &x2, &y2, &expiry, &arrival);
+        }
         packageInfo[i].request.packageId = i;
         packageInfo[i].request.pickup_x = x1;
         packageInfo[i].request.pickup_y = y1;
@@ -83,7 +592,7 @@ int main(int argc, char* argv[]) {
         packageInfo[i].request.dropoff_y = y2;
         packageInfo[i].request.arrival_turn = arrival;
         packageInfo[i].request.expiry_turn = expiry + arrival;
-        packageInfo[i].status = PACKAGE_WAITING;
+        packageInfo[i].status = soakMode ? PACKAGE_DELIVERED : PACKAGE_WAITING; // soak: a free id
         packageInfo[i].current_x = x1;
         packageInfo[i].current_y = y1;
         packageInfo[i].on_truck_id = -1;
@@ -95,15 +604,19 @@ int main(int argc, char* argv[]) {
 
     // Initialize Grid (Toll Booths)
     memset(localGrid, 0, sizeof(int) * MAX_GRID_SIZE * MAX_GRID_SIZE);
-    for (int i = 0; i < B; i++) {
-        int x, y, cost;
-        fscanf(testcaseFile, "%d %d %d", &x, &y, &cost);
-        localGrid[x][y] = cost;
+    if (generated) {
+        generateTollBooths(&generator, localGrid, NULL);
+    } else {
+        for (int i = 0; i < B; i++) {
+            int x, y, cost;
+            fscanf(testcaseFile, "%d %d %d", &x, &y, &cost);
+            localGrid[x][y] = cost;
+        }
+        fclose(testcaseFile);
     }
-    fclose(testcaseFile);
 
   // Delete the testcase file before running the student's solution.
-    int deletionProcessId = fork();
+    int deletionProcessId = generated ? -2 : fork();
     if (deletionProcessId == -1) {
         perror("Error while forking to delete the testcase file");
         exit(1);
@@ -115,6 +628,7 @@ int main(int argc, char* argv[]) {
             exit(1);
         }
     }
+    if (deletionProcessId > 0) waitpid(deletionProcessId, NULL, 0);
 
     // Initialize Trucks
     TruckInfo truckInfo[D];
@@ -144,7 +658,15 @@ int main(int argc, char* argv[]) {
     fclose(inputFile);
 
     gettimeofday(&start, NULL);
-    printf("Testcase %s\n", argv[1]);
+    printf("Testcase %s\n", testcaseLabel);
+    if (placement.pin) {
+        char helperCpus[256], solutionCpus[256], solverCpus[256];
+        formatCpuSet(&placement.helper, helperCpus, sizeof(helperCpus));
+        formatCpuSet(&placement.solution, solutionCpus, sizeof(solutionCpus));
+        formatCpuSet(&placement.solvers, solverCpus, sizeof(solverCpus));
+        printf("CPU placement (%s): turn loop %s, solution %s, solvers %s\n",
+               placement.domain, helperCpus, solutionCpus, solverCpus);
+    }
     fflush(stdout);
 
     int childId = fork();
@@ -152,32 +674,90 @@ int main(int argc, char* argv[]) {
         perror("Error while forking"); exit(1);
     }
     if (childId == 0) {
-        // Child process
-        if (execlp("./solution", "solution", NULL) == -1) {
+        // Child process. A soak's student gets its own process group, so a
+        // Ctrl-C at the terminal stops the soak instead of killing it.
+        if (soakMode) setpgid(0, 0);
+        if (placement.pin && sched_setaffinity(0, sizeof(cpu_set_t), &placement.solution) == -1) {
+            perror("Error pinning the solution"); exit(1);
+        }
+        if (execlp(solutionPath, "solution", NULL) == -1) {
             perror("Error in execlp"); exit(1);
         }
     }
+    studentPid = childId;
+    if (socketBackend) {
+        // Only the student holds the other ends now, so its exit reads as EOF.
+        for (int i = 0; i < S; i++) close(solverInfo[i].socketFds[1]);
+    }
 
 
     int requestsRemaining = totalRequests, upcomingRequest = 0, errorOccured = 0, expiredPackages = 0;
-    TurnReadyRequest turnReadyRequest;
     TurnChangeResponse turnChangeResponse;
     turnChangeResponse.mtype = 2;
     turnChangeResponse.errorOccured = 0;
     turnChangeResponse.finished = 0;
 
-    while (requestsRemaining > 0) {
+    // Queued turns (see TurnPlan in helper.h)
+    bool planActive = false;
+    int planLength = 0, planStep = 0, planStopOn = 0, queuedTurns = 0;
+    mainShmPtr->plan.length = 0;
+    mainShmPtr->plan.executed = 0;
+    mainShmPtr->plan.stopReason = PLAN_RAN_OUT;
+
+    // Arrivals the student has not been told about yet, oldest first. They
+    // only pile up while it is late (see TURN_DEADLINE_MS in helper.h).
+    int pendingArrivals[MAX_TOTAL_PACKAGES];
+    int pendingHead = 0, pendingCount = 0;
+
+    // Turn deadline: a default turn lets every truck stay and moves nothing.
+    bool studentLate = false;
+    unsigned long lateSinceNs = 0, latenessTotalNs = 0, latenessMaxNs = 0;
+    int missedTurns = 0, lateReplies = 0, lateRepliesIn = 0;
+    char stayMoves[D];
+    int noCommands[D];
+    for (int i = 0; i < D; i++) noCommands[i] = -1;
+
+    if (soakMode) upcomingRequest = totalRequests; // ids are issued by generateSoakArrivals
+
+    while (soakMode ? !soakStopRequested && (soak.turnLimit == 0 || turnNumber < soak.turnLimit)
+                    : requestsRemaining > 0) {
         turnNumber++;
         turnChangeResponse.turnNumber = turnNumber;
         turnChangeResponse.newPackageRequestCount = 0;
         for (int i = 0; i < totalRequests; i++) packageInfo[i].movedThisTurn = 0;
 
+        if (soakMode) {
+            PackageRequest arrivals[MAX_NEW_REQUESTS];
+            int count = generateSoakArrivals(&generator, &soak, turnNumber, arrivals);
+            for (int k = 0; k < count; k++) {
+                int id = arrivals[k].packageId;
+                PackageInfo* info = &packageInfo[id];
+                info->request = arrivals[k];
+                info->status = PACKAGE_WAITING;
+                info->current_x = arrivals[k].pickup_x;
+                info->current_y = arrivals[k].pickup_y;
+                info->on_truck_id = -1;
+                info->has_expired = false;
+                mainShmPtr->packageLocations[id][0] = info->current_x;
+                mainShmPtr->packageLocations[id][1] = info->current_y;
+                pendingArrivals[(pendingHead + pendingCount++) % MAX_TOTAL_PACKAGES] = id;
+            }
+        } else if (generated) {
+            PackageRequest arrivals[MAX_NEW_REQUESTS];
+            int count = generateTurnArrivals(&generator, turnNumber, arrivals);
+            for (int k = 0; k < count; k++) {
+                PackageInfo* info = &packageInfo[arrivals[k].packageId];
+                info->request = arrivals[k];
+                info->current_x = arrivals[k].pickup_x;
+                info->current_y = arrivals[k].pickup_y;
+            }
+        }
+
         while (upcomingRequest < totalRequests && packageInfo[upcomingRequest].request.arrival_turn == turnNumber) {
-            mainShmPtr->newPackageRequests[turnChangeResponse.newPackageRequestCount] = packageInfo[upcomingRequest].request;
             mainShmPtr->packageLocations[upcomingRequest][0] = packageInfo[upcomingRequest].current_x;
             mainShmPtr->packageLocations[upcomingRequest][1] = packageInfo[upcomingRequest].current_y;
+            pendingArrivals[(pendingHead + pendingCount++) % MAX_TOTAL_PACKAGES] = upcomingRequest;
             upcomingRequest++;
-            turnChangeResponse.newPackageRequestCount++;
         }
 
         for (int i = 0; i < upcomingRequest; i++) {
@@ -188,6 +768,7 @@ int main(int argc, char* argv[]) {
                 packageInfo[i].has_expired = true; // Mark as counted
                 packageInfo[i].status = PACKAGE_EXPIRED;
                 expiredPackages++;
+                soak.expired++;
             }
             else if (packageInfo[i].has_expired == true &&
                      packageInfo[i].status != PACKAGE_DELIVERED)
@@ -196,22 +777,99 @@ int main(int argc, char* argv[]) {
             }
         }
 
-        for (int i = 0; i < D; i++) {
+        // A late student is still cracking the strings it was woken with.
+        for (int i = 0; i < D && !studentLate; i++) {
             if (truckInfo[i].package_count > 0) {
                 createNewAuthString(currentAuthStrings[i], truckInfo[i].package_count);
+                currentPackedAuth[i] = packAuthString(i, currentAuthStrings[i]);
             }
         }
 
-        if (msgsnd(msgId, &turnChangeResponse, sizeof(TurnChangeResponse) - sizeof(long), 0) == -1) {
-            perror("Error in msgsnd (new turn)"); exit(1);
+        // Wait on a late student, run the next queued turn if the plan
+        // allows it, else ask the student.
+        bool queuedTurn = false, defaultTurn = false, replied = false;
+        if (studentLate) {
+            if (awaitTurnReady(msgId, monotonicNs() + turnDeadlineNs) == 0) {
+                unsigned long lateness = monotonicNs() - lateSinceNs;
+                latenessTotalNs += lateness;
+                if (lateness > latenessMaxNs) latenessMaxNs = lateness;
+                lateRepliesIn++;
+                studentLate = false;
+                replied = true;
+            } else {
+                defaultTurn = true;
+            }
+        } else if (planActive) {
+            int reason;
+            if (pendingCount > 0) reason = PLAN_STOPPED_ARRIVAL;
+            else if (planStep >= planLength) reason = PLAN_RAN_OUT;
+            else reason = queuedTurnStopReason(mainShmPtr, planStep, truckInfo, D, N, packageInfo, totalRequests);
+
+            if (reason == -1) {
+                memcpy(mainShmPtr->truckMovementInstructions, mainShmPtr->plan.truckMovementInstructions[planStep], sizeof(char) * D);
+                memcpy(mainShmPtr->pickUpCommands, mainShmPtr->plan.pickUpCommands[planStep], sizeof(int) * D);
+                memcpy(mainShmPtr->dropOffCommands, mainShmPtr->plan.dropOffCommands[planStep], sizeof(int) * D);
+                planStep++;
+                queuedTurns++;
+                mainShmPtr->plan.executed = planStep;
+                queuedTurn = true;
+            } else {
+                planActive = false;
+                mainShmPtr->plan.stopReason = reason;
+            }
         }
-        if (msgrcv(msgId, &turnReadyRequest, sizeof(TurnReadyRequest) - sizeof(long), 1, 0) == -1) {
-            perror("Error in msgrcv (turn ready)"); exit(1);
+
+        if (!queuedTurn && !defaultTurn && !replied) {
+            int count = pendingCount < MAX_NEW_REQUESTS ? pendingCount : MAX_NEW_REQUESTS;
+            for (int k = 0; k < count; k++) {
+                mainShmPtr->newPackageRequests[k] = packageInfo[pendingArrivals[pendingHead]].request;
+                pendingHead = (pendingHead + 1) % MAX_TOTAL_PACKAGES;
+            }
+            pendingCount -= count;
+            turnChangeResponse.newPackageRequestCount = count;
+
+            mainShmPtr->plan.length = 0;
+            unsigned long wokeAt = monotonicNs();
+            if (msgsnd(msgId, &turnChangeResponse, sizeof(TurnChangeResponse) - sizeof(long), 0) == -1) {
+                perror("Error in msgsnd (new turn)"); exit(1);
+            }
+            unsigned long deadlineNs = turnDeadlineNs ? wokeAt + turnDeadlineNs : 0;
+            if (awaitTurnReady(msgId, deadlineNs) == 0) {
+                replied = true;
+            } else {
+                // Nothing it writes is read until it replies.
+                studentLate = true;
+                lateSinceNs = deadlineNs;
+                lateReplies++;
+                defaultTurn = true;
+            }
+            soak.solutionNs += monotonicNs() - wokeAt;
+        }
+
+        if (replied) {
+            planLength = mainShmPtr->plan.length;
+            if (planLength > PLAN_MAX_TURNS) planLength = PLAN_MAX_TURNS;
+            planActive = planLength > 0;
+            planStep = 0;
+            planStopOn = mainShmPtr->plan.stopOn;
+            mainShmPtr->plan.executed = 0;
+            mainShmPtr->plan.stopReason = PLAN_RAN_OUT;
+            if (statsFile != NULL) reportSolverTurn(statsFile, turnNumber, S);
+        }
+
+        char* moveCommands = mainShmPtr->truckMovementInstructions;
+        int* pickUpCommands = mainShmPtr->pickUpCommands;
+        int* dropOffCommands = mainShmPtr->dropOffCommands;
+        if (defaultTurn) {
+            memset(stayMoves, 's', sizeof(stayMoves));
+            moveCommands = stayMoves;
+            pickUpCommands = dropOffCommands = noCommands;
+            missedTurns++;
         }
 
         // Validate Auth Strings
         for (int i = 0; i < D; i++) {
-            if (truckInfo[i].package_count > 0 && mainShmPtr->truckMovementInstructions[i] != 's') {
+            if (truckInfo[i].package_count > 0 && moveCommands[i] != 's') {
                 if (strcmp(mainShmPtr->authStrings[i], currentAuthStrings[i]) != 0) {
                     printf("Turn %d: ERROR - Truck %d auth string is incorrect.\n", turnNumber, i);
                     errorOccured = 1; break;
@@ -226,13 +884,13 @@ int main(int argc, char* argv[]) {
             if (truckInfo[i].turns_in_toll > 0) {
                 was_in_toll[i] = true; // Mark that we are serving a toll this turn
                 truckInfo[i].turns_in_toll--;
-                mainShmPtr->truckMovementInstructions[i] = 's'; // Force 'stay'
+                moveCommands[i] = 's'; // Force 'stay'
             }
         }
 
         // Process Drop-offs
         for (int i = 0; i < D; i++) {
-            int packageId = mainShmPtr->dropOffCommands[i];
+            int packageId = dropOffCommands[i];
             if (packageId == -1) continue;
 
             if (packageId < 0 || packageId >= totalRequests || packageInfo[packageId].status == PACKAGE_WAITING || packageInfo[packageId].on_truck_id != i) {
@@ -248,6 +906,7 @@ int main(int argc, char* argv[]) {
                 // Valid dropoff
                 packageInfo[packageId].status = PACKAGE_DELIVERED;
                 requestsRemaining--;
+                if (soakMode) soakDelivered(&soak, &packageInfo[packageId], turnNumber);
             }
             packageInfo[packageId].on_truck_id = -1;
             packageInfo[packageId].current_x = truckInfo[i].current_x;
@@ -266,7 +925,7 @@ int main(int argc, char* argv[]) {
 
         // Process Pickups
         for (int i = 0; i < D; i++) {
-            int packageId = mainShmPtr->pickUpCommands[i];
+            int packageId = pickUpCommands[i];
             if (packageId == -1) continue;
 
             if (packageId < 0 || packageId >= totalRequests || packageInfo[packageId].status == PACKAGE_ON_TRUCK || packageInfo[packageId].status == PACKAGE_DELIVERED) {
@@ -307,7 +966,7 @@ int main(int argc, char* argv[]) {
 
         // Process Movements
         for (int i = 0; i < D; i++) {
-            char move = mainShmPtr->truckMovementInstructions[i];
+            char move = moveCommands[i];
             int new_x = truckInfo[i].current_x;
             int new_y = truckInfo[i].current_y;
 
@@ -333,6 +992,10 @@ int main(int argc, char* argv[]) {
             int toll_cost = localGrid[new_x][new_y];
             if (toll_cost > 0 && !was_in_toll[i]) {
                 truckInfo[i].turns_in_toll = toll_cost;
+                if (planActive && (planStopOn & PLAN_STOP_TOLL)) {
+                    planActive = false;
+                    mainShmPtr->plan.stopReason = PLAN_STOPPED_TOLL;
+                }
             }
         }
         if (errorOccured) break;
@@ -348,14 +1011,34 @@ int main(int argc, char* argv[]) {
             mainShmPtr->packageLocations[i][1] = packageInfo[i].current_y;
         }
 
+        if (soakMode && turnNumber % soak.reportEvery == 0) reportSoakWindow(&soak, turnNumber, childId);
+
     } // End of main game loop
 
     // --- 6. Shutdown ---
+    if (soakMode) {
+        reportSoakWindow(&soak, turnNumber, childId);
+        printf("Soak ran %d turns: %ld arrived, %ld delivered (%.1f%% on time), %ld shed, %d still live.\n",
+               turnNumber, soak.arrivedTotal, soak.deliveredTotal,
+               soak.deliveredTotal ? 100.0 * soak.onTimeTotal / soak.deliveredTotal : 100.0,
+               soak.shedTotal, soak.live);
+    }
+    // The solution is still waiting for this last message, so its threads
+    // can be read now; once it exits they are gone.
+    long solutionMigrations = placement.report ? migrationsOfProcess(childId) : -1;
+    long loopMigrations = placement.report ? migrationsOfTask(getpid(), gettid()) : -1;
+    long solverMigrations = placement.report ? migrationsOfProcess(getpid()) - loopMigrations : -1;
+
     turnChangeResponse.errorOccured = errorOccured;
     turnChangeResponse.finished = 1;
     msgsnd(msgId, &turnChangeResponse, sizeof(TurnChangeResponse) - sizeof(long), 0);
 
-    wait(NULL); // Wait for student process to terminate
+    waitpid(childId, NULL, 0); // Wait for student process to terminate
+    studentPid = -1;
+    if (statsFile != NULL) {
+        reportSolverExit(statsFile, S, poolWorkers, poolWorkerCount);
+        fclose(statsFile);
+    }
     gettimeofday(&stop, NULL);
     double result = ((stop.tv_sec - start.tv_sec)) + ((stop.tv_usec - start.tv_usec) / 1e6);
     
@@ -363,6 +1046,25 @@ int main(int argc, char* argv[]) {
       "Your solution took %lf seconds to execute. This time may vary with "
       "server load, and won't be used for final evaluation.\n",
       result);
+    if (queuedTurns > 0) {
+        printf("%d of those turns ran from a queued plan without waking your solution.\n", queuedTurns);
+    }
+    if (turnDeadlineNs > 0) {
+        printf("Turn deadline %g ms: missed %d times, %d default turns played",
+               turnDeadlineNs / 1e6, lateReplies, missedTurns);
+        if (lateRepliesIn > 0) {
+            printf(", replies came %.2f ms late on average (max %.2f ms)",
+                   latenessTotalNs / 1e6 / lateRepliesIn, latenessMaxNs / 1e6);
+        }
+        if (studentLate) printf(", the last one never came");
+        printf(".\n");
+    }
+    if (placement.report && (solutionMigrations < 0 || loopMigrations < 0)) {
+        printf("CPU migrations are not reported by this kernel.\n");
+    } else if (placement.report) {
+        printf("CPU migrations: turn loop %ld, solver threads %ld, solution %ld.\n",
+               loopMigrations, solverMigrations, solutionMigrations);
+    }
     if(errorOccured){
         printf("Your solution took %d turns, and had a total of %d expired packages, "
                "but failed to complete the test case. These numbers do "
@@ -378,6 +1080,21 @@ int main(int argc, char* argv[]) {
     }
 
     msgctl(msgId, IPC_RMID, NULL); // Main queue
+    ipcMainMsgId = -1;
+
+    if (socketBackend) {
+        uint64_t stop = 1;
+        if (write(poolStopFd, &stop, sizeof(stop)) == -1) {
+            perror("Error stopping solver pool");
+        }
+        for (int w = 0; w < poolWorkerCount; w++) {
+            pthread_join(poolWorkers[w].threadId, NULL);
+            close(poolWorkers[w].epollFd);
+        }
+        for (int i = 0; i < S; i++) close(solverSockets[i]);
+        close(poolStopFd);
+        S = 0; // no SysV solver queues to tear down
+    }
 
     SolverRequest solverRequest;
     solverRequest.mtype = 1; // Exit mtype
@@ -385,48 +1102,268 @@ int main(int argc, char* argv[]) {
         msgsnd(solverInfo[i].msgId, &solverRequest, sizeof(solverRequest) - sizeof(long), 0);
         pthread_join(solverInfo[i].threadId, NULL);
         msgctl(solverInfo[i].msgId, IPC_RMID, NULL); // Solver queues
+        ipcSolverMsgIds[i] = -1;
     }
 
     shmdt(mainShmPtr);
     shmctl(shmId, IPC_RMID, 0); // Shared memory
+    ipcShmId = -1;
 
     return 0;
 }
 
+// Waits for the student's turn-ready message until deadlineNs on the
+// monotonic clock (0: no deadline). Returns 0 once it came, -1 if the
+// deadline passed first. SIGALRM is blocked in every other thread, so the
+// timer always interrupts this one.
+int awaitTurnReady(int msgId, unsigned long deadlineNs) {
+    TurnReadyRequest turnReadyRequest;
+    while (1) {
+        int flags = 0;
+        if (deadlineNs != 0) {
+            unsigned long now = monotonicNs();
+            if (now >= deadlineNs) {
+                flags = IPC_NOWAIT; // a last look, in case it just came in
+            } else {
+                unsigned long leftUs = (deadlineNs - now) / 1000 + 1;
+                struct itimerval timer = { .it_value = { .tv_sec = leftUs / 1000000, .tv_usec = leftUs % 1000000 } };
+                setitimer(ITIMER_REAL, &timer, NULL);
+            }
+        }
+        ssize_t received = msgrcv(msgId, &turnReadyRequest, sizeof(TurnReadyRequest) - sizeof(long), 1, flags);
+        if (deadlineNs != 0 && flags == 0) {
+            struct itimerval off = { { 0, 0 }, { 0, 0 } };
+            setitimer(ITIMER_REAL, &off, NULL);
+        }
+        if (received != -1) return 0;
+        if (flags == IPC_NOWAIT && errno == ENOMSG) return -1;
+        if (errno == EINTR) continue; // the deadline timer or a soak stop request
+        perror("Error in msgrcv (turn ready)"); exit(1);
+    }
+}
+
+// Whether queued turn `step` can run as if the student had sent it now:
+// -1 if so, otherwise the PLAN_STOPPED_* reason to wake the student with.
+// Mirrors the checks of the main loop without changing any state.
+int queuedTurnStopReason(MainSharedMemory* shm, int step, TruckInfo truckInfo[], int D, int N,
+                         PackageInfo packageInfo[], int totalRequests) {
+    const TurnPlan* plan = &shm->plan;
+    int droppedIds[MAX_TRUCKS], droppedCount = 0;
+
+    for (int i = 0; i < D; i++) {
+        char move = plan->truckMovementInstructions[step][i];
+        if (truckInfo[i].package_count > 0 && move != 's') return PLAN_STOPPED_AUTH;
+
+        if (truckInfo[i].turns_in_toll == 0) {
+            int new_x = truckInfo[i].current_x, new_y = truckInfo[i].current_y;
+            if (move == 'u') new_y--;
+            else if (move == 'd') new_y++;
+            else if (move == 'l') new_x--;
+            else if (move == 'r') new_x++;
+            else if (move != 's') return PLAN_STOPPED_INVALID;
+            if (new_x < 0 || new_x >= N || new_y < 0 || new_y >= N) return PLAN_STOPPED_INVALID;
+        }
+
+        int packageId = plan->dropOffCommands[step][i];
+        if (packageId == -1) continue;
+        if (packageId < 0 || packageId >= totalRequests || packageInfo[packageId].status == PACKAGE_WAITING ||
+            packageInfo[packageId].on_truck_id != i) {
+            return PLAN_STOPPED_INVALID;
+        }
+        droppedIds[droppedCount++] = packageId;
+    }
+
+    for (int i = 0; i < D; i++) {
+        int packageId = plan->pickUpCommands[step][i];
+        if (packageId == -1) continue;
+        if (packageId < 0 || packageId >= totalRequests ||
+            packageInfo[packageId].status == PACKAGE_ON_TRUCK || packageInfo[packageId].status == PACKAGE_DELIVERED) {
+            return PLAN_STOPPED_INVALID;
+        }
+        for (int k = 0; k < droppedCount; k++) {
+            if (droppedIds[k] == packageId) return PLAN_STOPPED_INVALID; // moved this turn
+        }
+        for (int j = 0; j < i; j++) {
+            if (plan->pickUpCommands[step][j] == packageId) return PLAN_STOPPED_INVALID;
+        }
+        if (truckInfo[i].current_x != packageInfo[packageId].current_x ||
+            truckInfo[i].current_y != packageInfo[packageId].current_y) {
+            return PLAN_STOPPED_INVALID;
+        }
+        int load = truckInfo[i].package_count;
+        if (plan->dropOffCommands[step][i] != -1) load--;
+        if (load >= TRUCK_MAX_CAP) return PLAN_STOPPED_INVALID;
+    }
+    return -1;
+}
+
+// Every packed guess is one compare against the truck's packed string.
+static void checkPackedGuesses(const PackedGuessRequest* request, PackedGuessResponse* response,
+                               SolverStats* stats) {
+    int count = request->count < PACKED_GUESS_MAX ? request->count : PACKED_GUESS_MAX;
+    if (count < 0) count = 0;
+    unsigned long hits = 0;
+    memset(response->hits, 0, sizeof(response->hits));
+    for (int k = 0; k < count; k++) {
+        unsigned long long guess = request->guesses[k];
+        unsigned long long truck = guess >> 45;
+        if (truck < MAX_TRUCKS && guess == currentPackedAuth[truck]) {
+            response->hits[k / 64] |= 1ULL << (k % 64);
+            hits++;
+        }
+    }
+    addStat(&stats->guesses, count);
+    addStat(&stats->hits, hits);
+}
+
 void* solverRoutine(void* args) {
     SolverArguments arguments = *(SolverArguments*)args;
     int targetTruck = 0;
+    union {
+        SolverRequest single;
+        PackedGuessRequest packed;
+    } message;
     SolverRequest request;
     SolverResponse response;
+    PackedGuessResponse packedResponse;
     response.mtype = 4;
     response.guessIsCorrect = 0;
+    packedResponse.mtype = 4;
 
     int messageQueueId;
     if ((messageQueueId = msgget(arguments.messageQueueKey, PERMS)) == -1) {
         perror("solverRoutine: msgget"); exit(1);
     }
 
+    SolverStats* stats = &solverStats[arguments.solverNumber];
+    unsigned long served = 0, waitStart = monotonicNs();
     while (1) {
         // Wait for a message of mtype 1, 2, or 3
-        if (msgrcv(messageQueueId, &request, sizeof(request) - sizeof(long), -3, 0) == -1) {
+        ssize_t got = msgrcv(messageQueueId, &message, sizeof(message) - sizeof(long), -3, 0);
+        if (got == -1) {
+            if (errno == EINTR) continue;
+            if (errno == EIDRM) pthread_exit(NULL); // helper is tearing down
             perror("solverRoutine: msgrcv"); exit(1);
         }
+        unsigned long workStart = monotonicNs();
+        bool packed = got == sizeof(PackedGuessRequest) - sizeof(long);
+        request = message.single;
+        addStat(&stats->idleNs, workStart - waitStart);
+
+        if (++served % QNUM_SAMPLE_EVERY == 0) {
+            struct msqid_ds queueState;
+            if (msgctl(messageQueueId, IPC_STAT, &queueState) == 0) {
+                addStat(&stats->qnumSamples, 1);
+                addStat(&stats->qnumTotal, queueState.msg_qnum);
+                if (queueState.msg_qnum > readStat(&stats->qnumMax)) {
+                    atomic_store_explicit(&stats->qnumMax, queueState.msg_qnum, memory_order_relaxed);
+                }
+            }
+        }
 
         switch (request.mtype) {
             case 1: // Exit signal
                 pthread_exit(NULL);
             case 2: // Set target truck
                 targetTruck = request.truckNumber;
+                addStat(&stats->retargets, 1);
                 break;
             case 3: // Check guess
+                if (packed) {
+                    checkPackedGuesses(&message.packed, &packedResponse, stats);
+                    if (msgsnd(messageQueueId, &packedResponse, sizeof(packedResponse) - sizeof(long), 0) == -1) {
+                        perror("solverRoutine: msgsnd");
+                    }
+                    break;
+                }
                 response.guessIsCorrect = 0;
                 if (strcmp(currentAuthStrings[targetTruck], request.authStringGuess) == 0) {
                     response.guessIsCorrect = 1;
                 }
+                addStat(&stats->guesses, 1);
+                addStat(&stats->hits, response.guessIsCorrect);
                 if (msgsnd(messageQueueId, &response, sizeof(response) - sizeof(long), 0) == -1) {
                     perror("solverRoutine: msgsnd");
                 }
         }
+        waitStart = monotonicNs();
+        addStat(&stats->busyNs, waitStart - workStart);
+    }
+}
+
+// Serves every solver socket registered with this worker's epoll set.
+// The stop eventfd is never read, so once signalled it wakes every worker.
+void* solverPoolRoutine(void* args) {
+    SolverPoolWorker* worker = (SolverPoolWorker*)args;
+    struct epoll_event events[64];
+    union {
+        SolverRequest single;
+        PackedGuessRequest packed;
+    } message;
+    SolverRequest request;
+    SolverResponse response;
+    PackedGuessResponse packedResponse;
+    response.mtype = 4;
+    response.guessIsCorrect = 0;
+    packedResponse.mtype = 4;
+
+    while (1) {
+        unsigned long waitStart = monotonicNs();
+        int ready = epoll_wait(worker->epollFd, events, 64, -1);
+        unsigned long workStart = monotonicNs();
+        addStat(&worker->idleNs, workStart - waitStart);
+        if (ready == -1) {
+            if (errno == EINTR) continue;
+            perror("solverPoolRoutine: epoll_wait"); exit(1);
+        }
+
+        for (int k = 0; k < ready; k++) {
+            int solver = events[k].data.u32;
+            if (solver == MAX_SOLVERS) return NULL; // Exit signal
+
+            SolverStats* stats = &solverStats[solver];
+            ssize_t got;
+            while ((got = recv(solverSockets[solver], &message, sizeof(message), MSG_DONTWAIT)) > 0) {
+                request = message.single;
+                switch (request.mtype) {
+                    case 1: // Student closed this solver
+                        got = 0;
+                        break;
+                    case 2: // Set target truck
+                        solverTargets[solver] = request.truckNumber;
+                        addStat(&stats->retargets, 1);
+                        continue;
+                    case 3: // Check guess
+                        if (got == sizeof(PackedGuessRequest)) {
+                            checkPackedGuesses(&message.packed, &packedResponse, stats);
+                            if (send(solverSockets[solver], &packedResponse, sizeof(packedResponse), MSG_NOSIGNAL) == -1) {
+                                perror("solverPoolRoutine: send");
+                            }
+                            continue;
+                        }
+                        response.guessIsCorrect = 0;
+                        if (strcmp(currentAuthStrings[solverTargets[solver]], request.authStringGuess) == 0) {
+                            response.guessIsCorrect = 1;
+                        }
+                        addStat(&stats->guesses, 1);
+                        addStat(&stats->hits, response.guessIsCorrect);
+                        if (send(solverSockets[solver], &response, sizeof(response), MSG_NOSIGNAL) == -1) {
+                            perror("solverPoolRoutine: send");
+                        }
+                        continue;
+                    default:
+                        continue;
+                }
+                break;
+            }
+            if (got == 0 || (got == -1 && errno != EAGAIN && errno != EWOULDBLOCK)) {
+                // Student end closed: stop watching this solver.
+                epoll_ctl(worker->epollFd, EPOLL_CTL_DEL, solverSockets[solver], NULL);
+            }
+            unsigned long now = monotonicNs();
+            addStat(&stats->busyNs, now - workStart);
+            workStart = now;
+        }
     }
 }
 
@@ -438,3 +1375,259 @@ void createNewAuthString(char* authStringLocation, int length) {
     }
     authStringLocation[length] = '\0';
 }
+
+// PACK_GUESS form of an auth string, the way a packed guess encodes it.
+unsigned long long packAuthString(int truck, const char* authString) {
+    unsigned long long letters = 0;
+    int length = strlen(authString);
+    for (int i = 0; i < length; i++) {
+        unsigned long long code = authString[i] == 'u' ? 0 : authString[i] == 'd' ? 1 : authString[i] == 'l' ? 2 : 3;
+        letters |= code << (2 * i);
+    }
+    return PACK_GUESS(truck, length, letters);
+}
+
+// --- Generated Workloads ---
+
+// splitmix64: one independent stream per (seed, stream) pair.
+static unsigned long long workloadNext(unsigned long long* state) {
+    unsigned long long z = (*state += 0x9E3779B97F4A7C15ULL);
+    z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ULL;
+    z = (z ^ (z >> 27)) * 0x94D049BB133111EBULL;
+    return z ^ (z >> 31);
+}
+
+static unsigned long long workloadStream(WorkloadGenerator* gen, unsigned long long stream) {
+    unsigned long long state = gen->seed ^ (stream * 0xD1B54A32D192ED03ULL);
+    workloadNext(&state);
+    return state;
+}
+
+// Uniform integer in [lo, hi].
+static int workloadRange(unsigned long long* state, int lo, int hi) {
+    return lo + (int)(workloadNext(state) % (unsigned long long)(hi - lo + 1));
+}
+
+// Checks the parameters and draws how many packages arrive on each turn:
+// a uniform turn per package, redrawn while that turn is full. Returns 0
+// on success, -1 if the parameters cannot produce a testcase.
+int initWorkload(WorkloadGenerator* gen) {
+    if (gen->N < 2 || gen->N > MAX_GRID_SIZE || gen->T < 1 || gen->requests < 0 ||
+        gen->maxNewPerTurn < 1 || gen->maxNewPerTurn > MAX_NEW_REQUESTS ||
+        (long)gen->T * gen->maxNewPerTurn < gen->requests ||
+        gen->B < 0 || gen->B > gen->N * gen->N || (gen->B > 0 && gen->maxBoothCost < 1)) {
+        return -1;
+    }
+
+    gen->arrivals = calloc(gen->T + 1, sizeof(int));
+    if (gen->arrivals == NULL) return -1;
+
+    unsigned long long state = workloadStream(gen, 0);
+    for (int i = 0; i < gen->requests; i++) {
+        int turn;
+        do {
+            turn = workloadRange(&state, 1, gen->T);
+        } while (gen->arrivals[turn] >= gen->maxNewPerTurn);
+        gen->arrivals[turn]++;
+    }
+    gen->nextId = 0;
+    return 0;
+}
+
+// One package arriving on `turn`; the caller sets its id.
+static void drawPackage(unsigned long long* state, int N, int turn, PackageRequest* p) {
+    do {
+        p->pickup_x = workloadRange(state, 0, N - 1);
+        p->pickup_y = workloadRange(state, 0, N - 1);
+        p->dropoff_x = workloadRange(state, 0, N - 1);
+        p->dropoff_y = workloadRange(state, 0, N - 1);
+    } while (p->pickup_x == p->dropoff_x && p->pickup_y == p->dropoff_y);
+
+    int minExpiry = 1 + abs(p->pickup_x - p->dropoff_x) + abs(p->pickup_y - p->dropoff_y);
+    p->arrival_turn = turn;
+    p->expiry_turn = turn + workloadRange(state, minExpiry, N * N);
+}
+
+// Draws the packages arriving on `turn` into out[] and returns how many.
+// Ids continue from the previous call, so turns must be drawn in order.
+int generateTurnArrivals(WorkloadGenerator* gen, int turn, PackageRequest out[]) {
+    if (turn < 1 || turn > gen->T) return 0;
+
+    unsigned long long state = workloadStream(gen, turn);
+    for (int k = 0; k < gen->arrivals[turn]; k++) {
+        drawPackage(&state, gen->N, turn, &out[k]);
+        out[k].packageId = gen->nextId++;
+    }
+    return gen->arrivals[turn];
+}
+
+// Places the B booths on distinct cells, writing them to dump if given.
+void generateTollBooths(WorkloadGenerator* gen, int grid[MAX_GRID_SIZE][MAX_GRID_SIZE], FILE* dump) {
+    unsigned long long state = workloadStream(gen, (unsigned long long)gen->T + 1);
+    for (int i = 0; i < gen->B; i++) {
+        int x, y;
+        do {
+            x = workloadRange(&state, 0, gen->N - 1);
+            y = workloadRange(&state, 0, gen->N - 1);
+        } while (grid[x][y] != 0);
+
+        grid[x][y] = workloadRange(&state, 1, gen->maxBoothCost);
+        if (dump != NULL) fprintf(dump, "%d %d %d\n", x, y, grid[x][y]);
+    }
+}
+
+// Writes the whole workload as a testcase file the helper can read back.
+int dumpWorkload(WorkloadGenerator* gen, const char* path, int D, int S) {
+    FILE* file = fopen(path, "w");
+    if (file == NULL) return -1;
+
+    fprintf(file, "%d %d %d %d %d %d\n", gen->N, D, S, gen->T, gen->B, gen->requests);
+
+    // A private generator, so the run's own id counter is left alone.
+    WorkloadGenerator copy = *gen;
+    copy.nextId = 0;
+    PackageRequest turnPackages[MAX_NEW_REQUESTS];
+    for (int turn = 1; turn <= gen->T; turn++) {
+        int count = generateTurnArrivals(&copy, turn, turnPackages);
+        for (int k = 0; k < count; k++) {
+            PackageRequest* p = &turnPackages[k];
+            fprintf(file, "%d %d %d %d %d %d\n", p->pickup_x, p->pickup_y, p->dropoff_x, p->dropoff_y,
+                    p->expiry_turn - p->arrival_turn, p->arrival_turn);
+        }
+    }
+
+    static int grid[MAX_GRID_SIZE][MAX_GRID_SIZE];
+    memset(grid, 0, sizeof(grid));
+    generateTollBooths(gen, grid, file);
+
+    return fclose(file);
+}
+
+// --- Soak Mode ---
+
+// Soak turns draw from streams well clear of the booth stream (T + 1 = 1).
+#define SOAK_STREAM_BASE (1ULL << 32)
+
+// Checks the parameters and puts every id in the free pool. Returns 0 on
+// success, -1 if the parameters cannot produce a workload.
+int initSoak(WorkloadGenerator* gen, SoakState* soak) {
+    if (gen->N < 2 || gen->N > MAX_GRID_SIZE || soak->rate <= 0 || soak->rate > MAX_NEW_REQUESTS ||
+        soak->turnLimit < 0 || soak->reportEvery < 1 ||
+        gen->B < 0 || gen->B > gen->N * gen->N || (gen->B > 0 && gen->maxBoothCost < 1)) {
+        return -1;
+    }
+    gen->T = 0;
+    gen->requests = 0;
+    gen->maxNewPerTurn = MAX_NEW_REQUESTS;
+    gen->arrivals = NULL;
+    gen->nextId = 0;
+
+    for (int i = 0; i < MAX_TOTAL_PACKAGES; i++) {
+        soak->freeIds[i] = i;
+        soak->freedTurn[i] = -SOAK_ID_QUARANTINE;
+    }
+    soak->freeHead = 0;
+    soak->freeCount = MAX_TOTAL_PACKAGES;
+    soak->live = 0;
+    soak->arrived = soak->delivered = soak->onTime = soak->expired = soak->shed = 0;
+    memset(soak->latency, 0, sizeof(soak->latency));
+    soak->solutionNs = 0;
+    soak->windowStartNs = monotonicNs();
+    soak->windowStartTurn = 0;
+    soak->arrivedTotal = soak->deliveredTotal = soak->onTimeTotal = soak->shedTotal = 0;
+    return 0;
+}
+
+// Draws this turn's arrivals into out[] and returns how many got an id.
+// The count is binomial over MAX_NEW_REQUESTS slots with mean rate.
+int generateSoakArrivals(WorkloadGenerator* gen, SoakState* soak, int turn, PackageRequest out[]) {
+    unsigned long long state = workloadStream(gen, SOAK_STREAM_BASE + turn);
+    unsigned long long threshold = ULLONG_MAX;
+    if (soak->rate < MAX_NEW_REQUESTS) {
+        threshold = (unsigned long long)(soak->rate / MAX_NEW_REQUESTS * (double)ULLONG_MAX);
+    }
+    int wanted = 0;
+    for (int k = 0; k < MAX_NEW_REQUESTS; k++) {
+        if (workloadNext(&state) <= threshold) wanted++;
+    }
+
+    int count = 0;
+    for (int k = 0; k < wanted; k++) {
+        if (soak->freeCount == 0 || soak->freedTurn[soak->freeHead] + SOAK_ID_QUARANTINE > turn) {
+            soak->shed += wanted - k;
+            soak->shedTotal += wanted - k;
+            break;
+        }
+        drawPackage(&state, gen->N, turn, &out[count]);
+        out[count++].packageId = soak->freeIds[soak->freeHead];
+        soak->freeHead = (soak->freeHead + 1) % MAX_TOTAL_PACKAGES;
+        soak->freeCount--;
+    }
+    soak->live += count;
+    soak->arrived += count;
+    soak->arrivedTotal += count;
+    return count;
+}
+
+// Records a delivery and returns its id to the pool.
+void soakDelivered(SoakState* soak, PackageInfo* info, int turn) {
+    int latency = turn - info->request.arrival_turn;
+    soak->latency[latency < SOAK_LATENCY_BUCKETS ? latency : SOAK_LATENCY_BUCKETS - 1]++;
+    soak->delivered++;
+    soak->deliveredTotal++;
+    if (turn <= info->request.expiry_turn) {
+        soak->onTime++;
+        soak->onTimeTotal++;
+    }
+
+    int tail = (soak->freeHead + soak->freeCount) % MAX_TOTAL_PACKAGES;
+    soak->freeIds[tail] = info->request.packageId;
+    soak->freedTurn[tail] = turn;
+    soak->freeCount++;
+    soak->live--;
+}
+
+static int latencyPercentile(SoakState* soak, double fraction) {
+    long want = (long)(fraction * soak->delivered + 0.5), seen = 0;
+    for (int b = 0; b < SOAK_LATENCY_BUCKETS; b++) {
+        seen += soak->latency[b];
+        if (seen >= want && seen > 0) return b;
+    }
+    return 0;
+}
+
+// Resident set size of a process in MB, or -1 if /proc cannot say.
+static double residentMb(pid_t pid) {
+    char path[64];
+    long pages, resident;
+    snprintf(path, sizeof(path), "/proc/%d/statm", (int)pid);
+    FILE* file = fopen(path, "r");
+    if (file == NULL) return -1;
+    int read = fscanf(file, "%ld %ld", &pages, &resident);
+    fclose(file);
+    return read == 2 ? resident * (double)sysconf(_SC_PAGESIZE) / (1 << 20) : -1;
+}
+
+// Prints the window since the last report and starts a new one.
+void reportSoakWindow(SoakState* soak, int turn, pid_t studentPid) {
+    int turns = turn - soak->windowStartTurn;
+    if (turns <= 0) return;
+    unsigned long now = monotonicNs();
+    double seconds = (now - soak->windowStartNs) / 1e9;
+
+    printf("Soak turn %d: %.1f arrivals/turn, %.1f deliveries/turn, latency p50 %d p99 %d turns, "
+           "%.1f%% on time, %ld expired, %ld shed, %d live, %.0f turns/s, solution %.3f ms/turn, "
+           "RSS helper %.1f MB solution %.1f MB\n",
+           turn, (double)soak->arrived / turns, (double)soak->delivered / turns,
+           latencyPercentile(soak, 0.5), latencyPercentile(soak, 0.99),
+           soak->delivered ? 100.0 * soak->onTime / soak->delivered : 100.0, soak->expired, soak->shed,
+           soak->live, seconds > 0 ? turns / seconds : 0.0, soak->solutionNs / 1e6 / turns,
+           residentMb(getpid()), residentMb(studentPid));
+    fflush(stdout);
+
+    soak->arrived = soak->delivered = soak->onTime = soak->expired = soak->shed = 0;
+    memset(soak->latency, 0, sizeof(soak->latency));
+    soak->solutionNs = 0;
+    soak->windowStartNs = now;
+    soak->windowStartTurn = turn;
+}
@@ -4,11 +4,13 @@
 #include <pthread.h>
 #include <stdio.h>
 #include <stdlib.h>
+#include <stdatomic.h>
 #include <stdbool.h>
 #include <string.h>
 #include <sys/ipc.h>
 #include <sys/msg.h>
 #include <sys/shm.h>
+#include <sys/socket.h>
 #include <sys/time.h>
 #include <sys/types.h>
 #include <sys/wait.h>
@@ -27,6 +29,17 @@
 #define MAX_NEW_REQUESTS 50
 #define MAX_TOTAL_PACKAGES 5000
 
+// --- Solver Backends ---
+// SOLVER_BACKEND=sysv (default): one SysV queue and one thread per solver.
+// SOLVER_BACKEND=socket: one SOCK_SEQPACKET socketpair per solver, served by
+// a fixed pool of epoll workers (SOLVER_WORKERS, default one per CPU). The
+// student end of each pair is inherited by ./solution, and its descriptor
+// number is written to input.txt where the queue key would otherwise go.
+// Messages carry the whole SolverRequest/SolverResponse, mtype included.
+#define SOLVER_BACKEND_ENV "SOLVER_BACKEND"
+#define SOLVER_WORKERS_ENV "SOLVER_WORKERS"
+#define MAX_SOLVER_WORKERS 64
+
 // --- IPC Message Structs ---
 
 // Student -> Helper: Signals turn commands are set in SHM
@@ -54,6 +67,39 @@ typedef struct PackageRequest {
     int expiry_turn;
 } PackageRequest;
 
+// --- Multi-Turn Plans ---
+// Along with this turn's commands, the student may queue commands for up to
+// PLAN_MAX_TURNS following turns. The helper runs them without sending a
+// TurnChangeResponse and wakes the student on the first turn it cannot or
+// should not run. New arrivals, a queued move of a loaded truck (it needs
+// that turn's auth string) and a queued command the helper would reject
+// always end the plan. Everything in stopOn ends it as well. Queued turns
+// are one-shot: the helper clears length whenever it wakes the student.
+#define PLAN_MAX_TURNS 16
+
+// stopOn flags
+#define PLAN_STOP_TOLL 1    // wake the turn after a truck enters a toll booth
+
+// stopReason values
+#define PLAN_RAN_OUT        0   // every queued turn ran (or none was queued)
+#define PLAN_STOPPED_ARRIVAL 1
+#define PLAN_STOPPED_AUTH    2
+#define PLAN_STOPPED_INVALID 3
+#define PLAN_STOPPED_TOLL    4
+
+typedef struct TurnPlan {
+    // --- FROM Student ---
+    int length;                                              // queued turns, 0 = none
+    int stopOn;                                              // PLAN_STOP_* flags
+    char truckMovementInstructions[PLAN_MAX_TURNS][MAX_TRUCKS];
+    int pickUpCommands[PLAN_MAX_TURNS][MAX_TRUCKS];
+    int dropOffCommands[PLAN_MAX_TURNS][MAX_TRUCKS];
+
+    // --- FROM Helper ---
+    int executed;    // queued turns run since the student last answered
+    int stopReason;  // why the student was woken
+} TurnPlan;
+
 // --- Shared Memory Structure ---
 typedef struct MainSharedMemory {
     // --- Data FROM Student TO Helper ---
@@ -68,6 +114,9 @@ typedef struct MainSharedMemory {
     int truckTurnsInToll[MAX_TRUCKS];
     PackageRequest newPackageRequests[MAX_NEW_REQUESTS];
     int packageLocations[MAX_TOTAL_PACKAGES][2]; // (x, y) or (-1, -1) if on truck
+
+    // Kept last so students that map only the fields above still attach.
+    TurnPlan plan;
 } MainSharedMemory;
 
 // --- Solver Process Structs ---
@@ -85,6 +134,30 @@ typedef struct SolverResponse {
     int guessIsCorrect; // 1 if correct, 0 if incorrect
 } SolverResponse;
 
+// --- Packed Guesses ---
+// A PackedGuessRequest goes out as mtype 3 like a single guess; the solver
+// tells the two apart by message size. It carries up to PACKED_GUESS_MAX
+// guesses, each one word holding the truck number, the string length and
+// the string at two bits per letter (u=0 d=1 l=2 r=3, first letter in the
+// lowest bits), so it needs no mtype 2 retarget and the solver checks it
+// with a single integer compare. The reply is mtype 4, a PackedGuessResponse
+// with bit k of hits set if guess k was correct. Both are sent whole,
+// whatever count is.
+#define PACKED_GUESS_MAX 256
+#define PACK_GUESS(truck, length, letters) \
+    (((unsigned long long)(truck) << 45) | ((unsigned long long)(length) << 40) | (unsigned long long)(letters))
+
+typedef struct PackedGuessRequest {
+    long mtype;                                   // 3
+    int count;
+    unsigned long long guesses[PACKED_GUESS_MAX]; // PACK_GUESS values
+} PackedGuessRequest;
+
+typedef struct PackedGuessResponse {
+    long mtype;                                   // 4
+    unsigned long long hits[PACKED_GUESS_MAX / 64];
+} PackedGuessResponse;
+
 // Arguments for launching a solver thread
 typedef struct SolverArguments {
     int solverNumber;
@@ -96,8 +169,57 @@ typedef struct SolverInfo {
     pthread_t threadId;
     key_t msgKey;
     int msgId;
+    int socketFds[2]; // socket backend: [0] helper end, [1] student end
 } SolverInfo;
 
+// One epoll worker of the socket backend
+typedef struct SolverPoolWorker {
+    pthread_t threadId;
+    int epollFd;
+    atomic_ulong idleNs; // blocked in epoll_wait
+} SolverPoolWorker;
+
+// --- CPU Placement ---
+// CPU_PLACEMENT=auto pins the helper's turn loop, the solution and the
+// solver threads inside one last-level-cache domain read from /sys: the one
+// the helper starts on, within the CPUs it may use (NUMA node if the cache
+// topology is missing). HELPER_CPUS, SOLUTION_CPUS and SOLVER_CPUS take cpu
+// lists such as "0-3,8" and override the automatic sets; any of them turns
+// placement on. CPU_PLACEMENT=report pins nothing. Either way the helper
+// prints at exit how often each side migrated between CPUs.
+#define CPU_PLACEMENT_ENV "CPU_PLACEMENT"
+#define HELPER_CPUS_ENV "HELPER_CPUS"
+#define SOLUTION_CPUS_ENV "SOLUTION_CPUS"
+#define SOLVER_CPUS_ENV "SOLVER_CPUS"
+
+// --- Turn Deadline ---
+// TURN_DEADLINE_MS=ms gives the student that much wall-clock time to answer
+// each turn it is woken for. A turn it misses is played as a default turn:
+// every truck stays, nothing is picked up or dropped off. So is every turn
+// after it until the late reply comes in. Since nothing moved and the auth
+// strings are kept meanwhile, that reply is still valid and is applied on
+// the turn it arrives. Packages that arrived while the student was late are
+// announced when it is next woken.
+#define TURN_DEADLINE_ENV "TURN_DEADLINE_MS"
+
+// --- Solver Statistics ---
+// Counted by whichever thread serves the solver and read by the main thread.
+// With SOLVER_STATS=path the helper writes one line per student turn and a
+// per-solver table at exit to that file.
+#define SOLVER_STATS_ENV "SOLVER_STATS"
+#define QNUM_SAMPLE_EVERY 32 // requests between msg_qnum samples (SysV only)
+
+typedef struct SolverStats {
+    atomic_ulong guesses;     // mtype 3 served
+    atomic_ulong retargets;   // mtype 2 served
+    atomic_ulong hits;        // correct guesses
+    atomic_ulong busyNs;      // handling requests
+    atomic_ulong idleNs;      // blocked waiting for one (SysV threads)
+    atomic_ulong qnumSamples;
+    atomic_ulong qnumTotal;
+    atomic_ulong qnumMax;
+} __attribute__((aligned(64))) SolverStats;
+
 typedef enum {
     PACKAGE_WAITING,
     PACKAGE_ON_TRUCK,
@@ -125,8 +247,71 @@ typedef struct TruckInfo {
     int turns_in_toll; // Turns remaining to wait
 } TruckInfo;
 
+// --- Generated Workloads ---
+// "./helper -g N D S T B maxNewPerTurn requests maxBoothCost seed" draws
+// the testcase itself, with the distribution of generate_test_case in
+// testcase_gen.py but a random stream of its own. Only the per-turn arrival
+// counts and the toll booths exist up front; each turn's packages are drawn
+// when that turn starts, from a stream seeded by (seed, turn), so a dump
+// (-o path) reproduces exactly what a run sees.
+typedef struct WorkloadGenerator {
+    int N, T, B, maxNewPerTurn, requests, maxBoothCost;
+    unsigned long long seed;
+    int* arrivals;   // arrivals[t] packages arrive on turn t, 1..T
+    int nextId;      // id of the next package drawn
+} WorkloadGenerator;
+
+// --- Soak Mode ---
+// "./helper -s N D S B rate maxBoothCost seed [turns [reportEvery]]" runs an
+// open-ended workload: on average `rate` packages arrive every turn (at most
+// MAX_NEW_REQUESTS), drawn like -g draws them, until `turns` have run or the
+// helper gets SIGINT/SIGTERM (0 or no turns: run until signalled). Package
+// ids come from a pool of MAX_TOTAL_PACKAGES and are handed out again
+// SOAK_ID_QUARANTINE turns after delivery, so memory stays bounded however
+// long it runs. Expired packages still have to be delivered, so they keep
+// their id until then; an arrival that finds the pool empty is shed. Every
+// reportEvery turns the helper prints throughput, latency and memory use
+// over the window just ended.
+#define SOAK_REPORT_EVERY 1000
+#define SOAK_ID_QUARANTINE 2
+#define SOAK_LATENCY_BUCKETS 1024   // turns; the last bucket collects the rest
+
+typedef struct SoakState {
+    double rate;
+    long turnLimit;                   // 0 = until signalled
+    int reportEvery;
+
+    int freeIds[MAX_TOTAL_PACKAGES];  // ring, oldest delivery first
+    int freedTurn[MAX_TOTAL_PACKAGES];
+    int freeHead, freeCount;
+    int live;                         // ids handed out and not yet delivered
+
+    // Current window; reset by reportSoakWindow
+    long arrived, delivered, onTime, expired, shed;
+    long latency[SOAK_LATENCY_BUCKETS];
+    unsigned long solutionNs;         // waiting for the student's reply
+    unsigned long windowStartNs;
+    int windowStartTurn;
+
+    // Whole run
+    long arrivedTotal, deliveredTotal, onTimeTotal, shedTotal;
+} SoakState;
+
+int initWorkload(WorkloadGenerator* gen);
+int initSoak(WorkloadGenerator* gen, SoakState* soak);
+int generateSoakArrivals(WorkloadGenerator* gen, SoakState* soak, int turn, PackageRequest out[]);
+void soakDelivered(SoakState* soak, PackageInfo* info, int turn);
+void reportSoakWindow(SoakState* soak, int turn, pid_t studentPid);
+int generateTurnArrivals(WorkloadGenerator* gen, int turn, PackageRequest out[]);
+void generateTollBooths(WorkloadGenerator* gen, int grid[MAX_GRID_SIZE][MAX_GRID_SIZE], FILE* dump);
+int dumpWorkload(WorkloadGenerator* gen, const char* path, int D, int S);
 
+int awaitTurnReady(int msgId, unsigned long deadlineNs);
+int queuedTurnStopReason(MainSharedMemory* shm, int step, TruckInfo truckInfo[], int D, int N,
+                         PackageInfo packageInfo[], int totalRequests);
 void* solverRoutine(void* args);
+void* solverPoolRoutine(void* args);
 void createNewAuthString(char* authStringLocation, int length);
+unsigned long long packAuthString(int truck, const char* authString);
 
 #endif // HELPER_H
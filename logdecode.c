@@ -0,0 +1,120 @@
+// Offline decoder for the binary event log written by solution.c.
+// Prints the same human-readable trace the solution used to print.
+//
+//   gcc logdecode.c -o logdecode
+//   ./logdecode [solution.log]
+
+#include <stdio.h>
+#include <string.h>
+
+#include "eventlog.h"
+
+// Ids still expected for the list currently being printed.
+static int pendingIds = 0;
+static int printedIds = 0;
+
+static void begin_list(int count) {
+    pendingIds = count;
+    printedIds = 0;
+    if (pendingIds == 0) printf("]\n");
+}
+
+static void print_chunk(const LogRecord *r) {
+    for (int k = 0; k < r->a[0] && pendingIds > 0; k++) {
+        if (printedIds > 0) printf(", ");
+        printf("%d", r->a[1 + k]);
+        printedIds++;
+        pendingIds--;
+    }
+    if (pendingIds == 0) printf("]\n");
+}
+
+static void print_record(const LogRecord *r) {
+    switch (r->type) {
+        case EV_TURN:
+            printf("Turn %d: newPackageRequestCount = %d\n", r->turn, r->a[0]);
+            break;
+        case EV_NEW_PACKAGE:
+            printf("New package %d -> pickup(%d,%d) drop(%d,%d)\n",
+                   r->a[0], r->a[1], r->a[2], r->a[3], r->a[4]);
+            break;
+        case EV_NO_TRUCK:
+            printf("[Assign] No suitable truck found for package %d (even RELAXED), re-queued.\n",
+                   r->a[0]);
+            break;
+        case EV_TRUCK_STATE:
+            printf("Truck %d: pos=(%d,%d), currentPackageCount=%d\n",
+                   r->truck, r->a[0], r->a[1], r->a[2]);
+            break;
+        case EV_ASSIGN_SUMMARY:
+            printf("  Truck %d: onboard=%d, assigned=%d -> [", r->truck, r->a[0], r->a[1]);
+            begin_list(r->a[1]);
+            break;
+        case EV_MOVES_BEGIN:
+            printf("=== Movement Decisions This Turn ===\n");
+            break;
+        case EV_MOVE:
+            printf("Truck %d at (%d,%d): move=%c, pickUp=%d, dropOff=%d\n",
+                   r->truck, r->a[0], r->a[1], (char)r->a[2], r->a[3], r->a[4]);
+            break;
+        case EV_ID_LIST:
+            printf(r->a[0] == LOG_LIST_ONBOARD ? "   Onboard: [" : "   Assigned: [");
+            begin_list(r->a[1]);
+            break;
+        case EV_ID_CHUNK:
+            print_chunk(r);
+            break;
+        case EV_DROPPED:
+            printf("[log] %d records dropped before turn %d (ring full)\n", r->a[0], r->turn);
+            break;
+        case EV_ROLLOUT: {
+            static const char *names[] = {"slack", "nearest", "edf"};
+            int k = r->a[0];
+            printf("[Rollout] policy=%s projected expired=%d delivered=%d\n",
+                   (k >= 0 && k < 3) ? names[k] : "?", r->a[1], r->a[2]);
+            break;
+        }
+        case EV_RELAY:
+            printf("[Relay] Package %d handed off at (%d,%d) by truck %d\n",
+                   r->a[0], r->a[1], r->a[2], r->truck);
+            break;
+        case EV_RELAXED:
+            printf("[Assign] Package %d assigned to truck %d (RELAXED fallback, load=%d)\n",
+                   r->a[0], r->truck, r->a[1]);
+            break;
+        case EV_LIST_FULL:
+            printf("[Assign] WARNING: truck %d assigned list full, re-queuing package %d\n",
+                   r->truck, r->a[0]);
+            break;
+        default:
+            printf("[log] unknown record type %d\n", r->type);
+            break;
+    }
+}
+
+int main(int argc, char *argv[]) {
+    const char *path = (argc > 1) ? argv[1] : "solution.log";
+
+    FILE *fp = fopen(path, "rb");
+    if (fp == NULL) {
+        perror("Error opening log file");
+        return 1;
+    }
+
+    LogFileHeader h;
+    if (fread(&h, sizeof(h), 1, fp) != 1 ||
+        memcmp(h.magic, LOG_MAGIC, sizeof(LOG_MAGIC)) != 0 ||
+        h.recordSize != sizeof(LogRecord)) {
+        printf("Error: %s is not a solution event log.\n", path);
+        fclose(fp);
+        return 1;
+    }
+
+    LogRecord r;
+    while (fread(&r, sizeof(r), 1, fp) == 1) {
+        print_record(&r);
+    }
+
+    fclose(fp);
+    return 0;
+}
@@ -0,0 +1,410 @@
+// Microbenchmarks for the planner kernels of solution.c, run on synthetic
+// fleets and backlogs without a helper, IPC or solvers. Prints ns/op, the
+// spread over rounds and heap allocations per op for each kernel, and how
+// each one scales with the fleet size D, the load per truck and the backlog
+// of unassigned packages.
+//
+//   gcc -O2 planbench.c -lpthread -o planbench
+//   ./planbench [-r rounds] [-m ms] [kernel...]
+//
+// Kernels: manhattan, route_length (compute_truck_route_length, one truck
+// per op), assign (assignPackagesToTrucks, one call placing up to
+// batch_size packages) and decide (decide_truck_actions for the whole
+// fleet, with every cached target invalidated, as after a learned toll).
+//
+// Every scenario is built from a fixed seed, so a given commit always sees
+// the same work: trucks at random cells, `load` packages each (two thirds
+// on board, the rest assigned), `backlog` unassigned packages triaged as
+// the solution would, and 2N/5 toll booths the oracle already knows. Each
+// scenario runs in its own process, so solution.c's globals start clean.
+// assign and decide change the state they plan on; it is restored from a
+// snapshot before every call, outside the timed region. The distance oracle
+// keeps what it cached while the scenario was triaged, and its fill budget
+// is spent then, so travel_time answers from those fields or the landmark
+// bound and no hot-destination fill lands in a timed call.
+//
+// A scenario may cap decide's time relative to the base case. A row over
+// its cap is marked REGRESSION and planbench exits with status 2. The N=500
+// row is capped because oracle_next_move once filled a full field per
+// target there, which made decide thousands of times slower than the base.
+//
+// The reported figure is the median over the rounds; spread is
+// (max - min) / median. Allocations count every malloc, calloc and realloc
+// made during the timed calls. SOLUTION_PARAMS and FLEET_KERNEL apply as in
+// the solution. For numbers comparable across commits, build both with the
+// same flags and pin the run to one CPU (taskset -c 2 ./planbench).
+
+#define PLANBENCH   // solution.c's main is left out
+#include "solution.c"
+
+#include <sys/mman.h>
+#include <sys/wait.h>
+
+#define BENCH_TURN        100     // turn the scenarios are planned on
+#define DEFAULT_ROUNDS    7
+#define DEFAULT_ROUND_MS  40
+#define MANHATTAN_POINTS  1024
+
+typedef struct Scenario {
+    int N, D, load, backlog;
+    double decideCap;    // most decide may take vs the base case, 0 for none
+} Scenario;
+
+// The base case first; every other row changes one of D, load or backlog
+// (or N), and is reported against it.
+static const Scenario scenarios[] = {
+    {200, 100,  5,  200},
+    {200,  25,  5,  200},
+    {200,  50,  5,  200},
+    {200, 250,  5,  200},
+    {200, 100,  0,  200},
+    {200, 100,  2,  200},
+    {200, 100, 10,  200},
+    {200, 100, 20,  200},
+    {200, 100,  5,   20},
+    {200, 100,  5, 1000},
+    {200, 100,  5, 4000},
+    { 50, 100,  5,  200},
+    {500, 100,  5,  200, 5.0},
+};
+#define SCENARIOS ((int)(sizeof(scenarios) / sizeof(scenarios[0])))
+
+enum { K_MANHATTAN, K_ROUTE_LENGTH, K_ASSIGN, K_DECIDE, KERNELS };
+static const char *kernelNames[KERNELS] = {"manhattan", "route_length", "assign", "decide"};
+
+typedef struct Result {
+    int ran;
+    double nsPerOp;      // median over rounds
+    double spread;       // (max - min) / median
+    double allocsPerOp;
+} Result;
+
+// Written by the scenario processes, read by the parent.
+static Result (*results)[KERNELS];
+
+// ---- Allocation counting ----
+// glibc's own entry points stay reachable under these names, so every heap
+// allocation in the process goes through here.
+extern void *__libc_malloc(size_t size);
+extern void *__libc_calloc(size_t n, size_t size);
+extern void *__libc_realloc(void *p, size_t size);
+
+static unsigned long allocations;
+
+void *malloc(size_t size) {
+    allocations++;
+    return __libc_malloc(size);
+}
+
+void *calloc(size_t n, size_t size) {
+    allocations++;
+    return __libc_calloc(n, size);
+}
+
+void *realloc(void *p, size_t size) {
+    allocations++;
+    return __libc_realloc(p, size);
+}
+
+static unsigned long now_ns(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (unsigned long)ts.tv_sec * 1000000000UL + ts.tv_nsec;
+}
+
+static unsigned long long rngState;
+
+static int rng_below(int n) {
+    rngState ^= rngState << 13;
+    rngState ^= rngState >> 7;
+    rngState ^= rngState << 17;
+    return (int)(rngState % (unsigned long long)n);
+}
+
+// ---- Scenario state ----
+
+static TruckInfo trucks[MAX_TRUCKS];
+
+static struct {
+    TruckInfo trucks[MAX_TRUCKS];
+    PackageInfo packages[MAX_TOTAL_PACKAGES];
+    int unassignedIds[MAX_TOTAL_PACKAGES];
+    int unassignedCount;
+    FleetSoA fleet;
+    unsigned char truckDirty[MAX_TRUCKS];
+    int planTargetX[MAX_TRUCKS], planTargetY[MAX_TRUCKS];
+    int planHasTarget[MAX_TRUCKS], planValidUntil[MAX_TRUCKS];
+} saved;
+
+static int add_package(int id, int N, int turn) {
+    PackageInfo *info = &allPackages[id];
+    PackageRequest p = {id, rng_below(N), rng_below(N), rng_below(N), rng_below(N),
+                        turn - rng_below(20), 0};
+    p.expiry_turn = turn + N / 4 + rng_below(2 * N);
+    info->used = 1;
+    info->assignedToTruck = -1;
+    info->pkg = p;
+    info->delivered = 0;
+    info->relayLeg = 0;
+    info->relays = 0;
+    info->droppedTurn = -1;
+    info->etaTruck = -1;
+    return id;
+}
+
+static void build_scenario(const Scenario *sc) {
+    int N = sc->N, D = sc->D, turn = BENCH_TURN;
+    rngState = 0x9e3779b97f4a7c15ULL ^ ((unsigned long long)N << 40 | (unsigned long long)D << 24 |
+                                        (unsigned long long)sc->load << 16 | (unsigned long long)sc->backlog);
+
+    fleet_init();
+    fleet_select_kernel();
+    params_load();
+    initTruckInfo(D, trucks);
+    oracle_init(N);
+    demand_init(N, turn + 1000);
+    for (int b = 0; b < 2 * N / 5; b++) {
+        int x = rng_below(N), y = rng_below(N);
+        if (x + y > 0) oracle_learn_toll(x, y, 1 + rng_below(10));
+    }
+
+    int nextId = 0;
+    int assigned = sc->load / 3;
+    for (int t = 0; t < D; t++) {
+        TruckInfo *truck = &trucks[t];
+        truck->x = fleet.x[t] = rng_below(N);
+        truck->y = fleet.y[t] = rng_below(N);
+        for (int k = 0; k < sc->load - assigned; k++) {
+            int id = add_package(nextId++, N, turn);
+            allPackages[id].assignedToTruck = t;
+            truck->packageIds[truck->currentPackageCount++] = id;
+        }
+        for (int k = 0; k < assigned; k++) {
+            int id = add_package(nextId++, N, turn);
+            allPackages[id].assignedToTruck = t;
+            truck->assignedPackageIds[truck->assignedCount++] = id;
+        }
+    }
+    for (int k = 0; k < sc->backlog && nextId < MAX_TOTAL_PACKAGES; k++) {
+        unassignedIds[unassignedCount++] = add_package(nextId++, N, turn);
+    }
+
+    oracle_new_turn();
+    triagePackages(trucks, D, turn);
+    fillBudget = 0;
+
+    memcpy(saved.trucks, trucks, sizeof(trucks));
+    memcpy(saved.packages, allPackages, sizeof(allPackages));
+    memcpy(saved.unassignedIds, unassignedIds, sizeof(unassignedIds));
+    saved.unassignedCount = unassignedCount;
+    saved.fleet = fleet;
+    memcpy(saved.truckDirty, truckDirty, sizeof(truckDirty));
+    memcpy(saved.planTargetX, planTargetX, sizeof(planTargetX));
+    memcpy(saved.planTargetY, planTargetY, sizeof(planTargetY));
+    memcpy(saved.planHasTarget, planHasTarget, sizeof(planHasTarget));
+    memcpy(saved.planValidUntil, planValidUntil, sizeof(planValidUntil));
+}
+
+// Back to the state build_scenario left, except for the oracle's cache.
+static void restore_scenario(void) {
+    memcpy(trucks, saved.trucks, sizeof(trucks));
+    memcpy(allPackages, saved.packages, sizeof(allPackages));
+    memcpy(unassignedIds, saved.unassignedIds, sizeof(unassignedIds));
+    unassignedCount = saved.unassignedCount;
+    fleet = saved.fleet;
+    memcpy(truckDirty, saved.truckDirty, sizeof(truckDirty));
+    memcpy(planTargetX, saved.planTargetX, sizeof(planTargetX));
+    memcpy(planTargetY, saved.planTargetY, sizeof(planTargetY));
+    memcpy(planHasTarget, saved.planHasTarget, sizeof(planHasTarget));
+    memcpy(planValidUntil, saved.planValidUntil, sizeof(planValidUntil));
+    worldDirty = 1;
+    planEvents = 0;
+    // Nothing drains the event log here; drop what the last call wrote.
+    atomic_store(&logHead, 0);
+    atomic_store(&logTail, 0);
+}
+
+// ---- Kernels ----
+// Each runs `ops` operations and returns the nanoseconds they took.
+
+static int manhattanPoints[MANHATTAN_POINTS][4];
+static volatile long sink;
+
+static unsigned long run_manhattan(const Scenario *sc, long ops) {
+    long sum = 0;
+    unsigned long start = now_ns();
+    for (long i = 0; i < ops; i++) {
+        const int *q = manhattanPoints[i & (MANHATTAN_POINTS - 1)];
+        sum += manhattan(q[0], q[1], q[2], q[3]);
+    }
+    unsigned long spent = now_ns() - start;
+    sink = sum;
+    (void)sc;
+    return spent;
+}
+
+static unsigned long run_route_length(const Scenario *sc, long ops) {
+    long sum = 0;
+    int endX, endY;
+    unsigned long start = now_ns();
+    for (long i = 0; i < ops; i++) {
+        sum += compute_truck_route_length(&trucks[i % sc->D], &endX, &endY) + endX;
+    }
+    unsigned long spent = now_ns() - start;
+    sink = sum;
+    return spent;
+}
+
+static unsigned long run_assign(const Scenario *sc, long ops) {
+    unsigned long spent = 0;
+    for (long i = 0; i < ops; i++) {
+        restore_scenario();
+        unsigned long start = now_ns();
+        assignPackagesToTrucks(trucks, sc->D, BENCH_TURN);
+        spent += now_ns() - start;
+    }
+    return spent;
+}
+
+static unsigned long run_decide(const Scenario *sc, long ops) {
+    static char moves[MAX_TRUCKS];
+    static int pickUps[MAX_TRUCKS], dropOffs[MAX_TRUCKS];
+    unsigned long spent = 0;
+    for (long i = 0; i < ops; i++) {
+        restore_scenario();
+        unsigned long start = now_ns();
+        decide_truck_actions(sc->D, trucks, allPackages, moves, pickUps, dropOffs, BENCH_TURN);
+        spent += now_ns() - start;
+    }
+    return spent;
+}
+
+typedef unsigned long (*KernelFn)(const Scenario *sc, long ops);
+static const KernelFn kernels[KERNELS] = {run_manhattan, run_route_length, run_assign, run_decide};
+
+static int cmp_double(const void *a, const void *b) {
+    double x = *(const double *)a, y = *(const double *)b;
+    return (x > y) - (x < y);
+}
+
+// One call to warm caches, then the rounds are sized so each takes about
+// roundMs, then `rounds` of them are timed.
+static void bench_kernel(int k, const Scenario *sc, int rounds, int roundMs, Result *out) {
+    long ops = 1;
+    unsigned long spent;
+    kernels[k](sc, 1);
+    while ((spent = kernels[k](sc, ops)) < 1000000UL * roundMs / 4 && ops < (1L << 40)) ops *= 2;
+    ops = (long)((double)ops * roundMs * 1e6 / (spent ? spent : 1)) + 1;
+
+    double ns[rounds];
+    unsigned long allocated = 0;
+    for (int r = 0; r < rounds; r++) {
+        unsigned long before = allocations;
+        spent = kernels[k](sc, ops);
+        allocated += allocations - before;
+        ns[r] = (double)spent / ops;
+    }
+    qsort(ns, rounds, sizeof(double), cmp_double);
+
+    out->nsPerOp = ns[rounds / 2];
+    out->spread = out->nsPerOp > 0 ? (ns[rounds - 1] - ns[0]) / out->nsPerOp : 0;
+    out->allocsPerOp = (double)allocated / ((double)ops * rounds);
+    out->ran = 1;
+}
+
+static void run_scenario(int s, const int wanted[], int rounds, int roundMs) {
+    const Scenario *sc = &scenarios[s];
+    build_scenario(sc);
+    for (int i = 0; i < MANHATTAN_POINTS; i++) {
+        for (int c = 0; c < 4; c++) manhattanPoints[i][c] = rng_below(sc->N);
+    }
+    for (int k = 0; k < KERNELS; k++) {
+        // manhattan does not depend on the scenario; time it once.
+        if (!wanted[k] || (k == K_MANHATTAN && s > 0)) continue;
+        bench_kernel(k, sc, rounds, roundMs, &results[s][k]);
+    }
+}
+
+int main(int argc, char *argv[]) {
+    int rounds = DEFAULT_ROUNDS, roundMs = DEFAULT_ROUND_MS;
+    int wanted[KERNELS] = {0}, anyWanted = 0;
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "-r") == 0 && i + 1 < argc) {
+            rounds = atoi(argv[++i]);
+            continue;
+        }
+        if (strcmp(argv[i], "-m") == 0 && i + 1 < argc) {
+            roundMs = atoi(argv[++i]);
+            continue;
+        }
+        int k = 0;
+        while (k < KERNELS && strcmp(kernelNames[k], argv[i]) != 0) k++;
+        if (k == KERNELS) {
+            printf("Usage: %s [-r rounds] [-m ms] [manhattan|route_length|assign|decide...]\n", argv[0]);
+            return 1;
+        }
+        wanted[k] = anyWanted = 1;
+    }
+    if (rounds < 1) rounds = 1;
+    if (roundMs < 1) roundMs = 1;
+    for (int k = 0; k < KERNELS; k++) wanted[k] |= !anyWanted;
+
+    results = mmap(NULL, sizeof(Result) * KERNELS * SCENARIOS, PROT_READ | PROT_WRITE,
+                   MAP_SHARED | MAP_ANONYMOUS, -1, 0);
+    if (results == MAP_FAILED) {
+        perror("Error in mmap for results");
+        return 1;
+    }
+
+    fleet_select_kernel();
+    params_load();
+    printf("planbench: %d rounds of ~%d ms, fleet kernel %s, batch_size %d\n",
+           rounds, roundMs, scoreFleetName, params.batchSize);
+    fflush(stdout);
+
+    for (int s = 0; s < SCENARIOS; s++) {
+        pid_t pid = fork();
+        if (pid == -1) {
+            perror("Error forking a scenario");
+            return 1;
+        }
+        if (pid == 0) {
+            run_scenario(s, wanted, rounds, roundMs);
+            _exit(0);
+        }
+        int status;
+        waitpid(pid, &status, 0);
+        if (!WIFEXITED(status) || WEXITSTATUS(status) != 0) {
+            printf("Scenario N=%d D=%d load=%d backlog=%d failed.\n",
+                   scenarios[s].N, scenarios[s].D, scenarios[s].load, scenarios[s].backlog);
+            return 1;
+        }
+    }
+
+    int regressions = 0;
+    printf("%-13s %4s %4s %4s %7s %12s %7s %9s %8s\n",
+           "kernel", "N", "D", "load", "backlog", "ns/op", "spread", "allocs/op", "vs base");
+    for (int k = 0; k < KERNELS; k++) {
+        for (int s = 0; s < SCENARIOS; s++) {
+            const Result *r = &results[s][k];
+            if (!r->ran) continue;
+            const Scenario *sc = &scenarios[s];
+            if (k == K_MANHATTAN) {
+                printf("%-13s %4s %4s %4s %7s %12.2f %6.1f%% %9.2f %8s\n", kernelNames[k],
+                       "-", "-", "-", "-", r->nsPerOp, 100 * r->spread, r->allocsPerOp, "-");
+                continue;
+            }
+            double vsBase = r->nsPerOp / results[0][k].nsPerOp;
+            int over = k == K_DECIDE && sc->decideCap > 0 && vsBase > sc->decideCap;
+            printf("%-13s %4d %4d %4d %7d %12.2f %6.1f%% %9.2f %7.2fx%s\n", kernelNames[k],
+                   sc->N, sc->D, sc->load, sc->backlog, r->nsPerOp, 100 * r->spread,
+                   r->allocsPerOp, vsBase, over ? "  REGRESSION" : "");
+            regressions += over;
+        }
+    }
+    if (regressions > 0) {
+        printf("%d row(s) over their cap vs base.\n", regressions);
+        return 2;
+    }
+    return 0;
+}
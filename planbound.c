@@ -0,0 +1,471 @@
+// Offline quality bounds for a testcase, with every arrival known up front.
+// Prints provable lower bounds on the helper's "turns" and "expired
+// packages", and what a clairvoyant reference planner achieves, so a
+// solution's numbers can be read as a gap. The testcase is not deleted.
+//
+//   gcc -O2 planbound.c -o planbound
+//   ./planbound testcase7.txt [-r rounds]
+//
+// Lower bounds. Trucks start at (0,0) and a package can be picked up no
+// earlier than its arrival turn, or than 1 + its distance from the origin.
+// It then needs at least the pickup-to-dropoff distance before it can be
+// dropped. That earliest drop turn bounds the last delivery (the helper's
+// turn count), and every package whose earliest drop is past its expiry
+// expires whatever a solution does. A truck moves every package it carries
+// by at most one cell a turn, so total pickup-to-dropoff distance over
+// D * TRUCK_MAX_CAP is a second bound on the turns.
+//
+// Reference planner. Packages are inserted one at a time, in arrival
+// order, at the cheapest pickup/dropoff positions of some truck's stop
+// list. Inserting a package that would turn a drop late costs heavily;
+// otherwise the cost is the delay added to the route and to the overall
+// last drop. Then `rounds` passes take every package out and insert it
+// again. After the first insertion and after every pass, the routes are run
+// turn by turn under the helper's rules (one drop and one pickup a turn,
+// drops before pickups before moves, toll waits). The best run is the
+// reference.
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <limits.h>
+
+#include "helper.h"
+
+#define CANDIDATE_TRUCKS 24     // trucks tried per insertion
+#define DROP_WINDOW      (2 * TRUCK_MAX_CAP) // stops a package may ride past
+#define LATE_COST        1000000
+#define DEFAULT_ROUNDS   2
+
+typedef struct Stop {
+    int pkg;
+    int pickup;   // 1 pickup, 0 dropoff
+} Stop;
+
+typedef struct Route {
+    Stop *stops;
+    int *time;    // model turn the stop's action happens
+    int *load;    // packages on board after the stop
+    int n, cap;
+} Route;
+
+static int N, D, S, T, B, R;
+static PackageRequest pkgs[MAX_TOTAL_PACKAGES];
+static int tollCost[MAX_GRID_SIZE][MAX_GRID_SIZE];
+static Route *routes;
+static int routeOf[MAX_TOTAL_PACKAGES];   // truck carrying the package, -1 if none
+
+static int manhattan(int x1, int y1, int x2, int y2) {
+    return abs(x1 - x2) + abs(y1 - y2);
+}
+
+static void stop_cell(Stop s, int *x, int *y) {
+    PackageRequest *p = &pkgs[s.pkg];
+    *x = s.pickup ? p->pickup_x : p->dropoff_x;
+    *y = s.pickup ? p->pickup_y : p->dropoff_y;
+}
+
+static int stop_ready(Stop s) {
+    return s.pickup ? pkgs[s.pkg].arrival_turn : 0;
+}
+
+// ---- Lower bounds ----
+
+static int earliest_drop(const PackageRequest *p) {
+    int pick = 1 + manhattan(0, 0, p->pickup_x, p->pickup_y);
+    if (p->arrival_turn > pick) pick = p->arrival_turn;
+    return pick + manhattan(p->pickup_x, p->pickup_y, p->dropoff_x, p->dropoff_y);
+}
+
+static void lower_bounds(int *turns, int *expired) {
+    long distance = 0;
+    *turns = 0;
+    *expired = 0;
+    for (int i = 0; i < R; i++) {
+        int drop = earliest_drop(&pkgs[i]);
+        if (drop > *turns) *turns = drop;
+        if (drop > pkgs[i].expiry_turn) (*expired)++;
+        distance += manhattan(pkgs[i].pickup_x, pkgs[i].pickup_y, pkgs[i].dropoff_x, pkgs[i].dropoff_y);
+    }
+    long perTurn = (long)D * TRUCK_MAX_CAP;
+    int fleetBound = (int)((distance + perTurn - 1) / perTurn);
+    if (fleetBound > *turns) *turns = fleetBound;
+}
+
+// ---- Route model ----
+// From the action turn at one cell to the action turn at the next: one
+// turn per cell, and one turn between two actions at the same cell.
+
+static int step_time(int fromTime, int fx, int fy, int tx, int ty) {
+    int d = manhattan(fx, fy, tx, ty);
+    return fromTime + (d > 0 ? d : 1);
+}
+
+// The truck acts at the origin on turn 1 at the earliest.
+static int first_time(int tx, int ty) {
+    return 1 + manhattan(0, 0, tx, ty);
+}
+
+static void route_retime(Route *r) {
+    int x = 0, y = 0, t = 0, load = 0;
+    for (int k = 0; k < r->n; k++) {
+        int cx, cy;
+        stop_cell(r->stops[k], &cx, &cy);
+        int at = (k == 0) ? first_time(cx, cy) : step_time(t, x, y, cx, cy);
+        int ready = stop_ready(r->stops[k]);
+        t = at > ready ? at : ready;
+        load += r->stops[k].pickup ? 1 : -1;
+        r->time[k] = t;
+        r->load[k] = load;
+        x = cx;
+        y = cy;
+    }
+}
+
+static void route_insert_at(Route *r, int k, Stop s) {
+    if (r->n == r->cap) {
+        r->cap = r->cap ? 2 * r->cap : 16;
+        r->stops = realloc(r->stops, r->cap * sizeof(Stop));
+        r->time = realloc(r->time, r->cap * sizeof(int));
+        r->load = realloc(r->load, r->cap * sizeof(int));
+        if (r->stops == NULL || r->time == NULL || r->load == NULL) {
+            perror("Error growing route");
+            exit(1);
+        }
+    }
+    memmove(&r->stops[k + 1], &r->stops[k], (r->n - k) * sizeof(Stop));
+    r->stops[k] = s;
+    r->n++;
+}
+
+static void route_remove_pkg(Route *r, int pkg) {
+    int w = 0;
+    for (int k = 0; k < r->n; k++) {
+        if (r->stops[k].pkg != pkg) r->stops[w++] = r->stops[k];
+    }
+    r->n = w;
+    route_retime(r);
+}
+
+static int route_end(const Route *r) {
+    return r->n > 0 ? r->time[r->n - 1] : 0;
+}
+
+// Where the truck stands, in the model, on turn `turn`.
+static void route_position_at(const Route *r, int turn, int *x, int *y) {
+    *x = 0;
+    *y = 0;
+    int lo = 0, hi = r->n - 1, last = -1;
+    while (lo <= hi) {
+        int mid = (lo + hi) / 2;
+        if (r->time[mid] <= turn) {
+            last = mid;
+            lo = mid + 1;
+        } else {
+            hi = mid - 1;
+        }
+    }
+    if (last >= 0) stop_cell(r->stops[last], x, y);
+}
+
+// ---- Insertion ----
+
+typedef struct Insertion {
+    long cost;
+    int truck, pickAt, dropAt;   // positions in the route before insertion
+} Insertion;
+
+// Slack of a drop that is still on time, INT_MAX for everything else.
+static int stop_slack(const Route *r, int k) {
+    if (r->stops[k].pickup) return INT_MAX;
+    int slack = pkgs[r->stops[k].pkg].expiry_turn - r->time[k];
+    return slack >= 0 ? slack : INT_MAX;
+}
+
+// Cheapest way to put package p into truck t's route. Later stops are
+// assumed to slip by the full delay at the first shifted stop, which can
+// only overstate the damage, since waiting for an arrival absorbs delay.
+static void best_insertion(int t, int p, int makespan, int *sufMin, Insertion *best) {
+    Route *r = &routes[t];
+    PackageRequest *pk = &pkgs[p];
+    int px = pk->pickup_x, py = pk->pickup_y, qx = pk->dropoff_x, qy = pk->dropoff_y;
+    int n = r->n;
+
+    sufMin[n] = INT_MAX;
+    for (int k = n - 1; k >= 0; k--) {
+        int s = stop_slack(r, k);
+        sufMin[k] = s < sufMin[k + 1] ? s : sufMin[k + 1];
+    }
+
+    for (int i = 0; i <= n; i++) {
+        int loadBefore = (i == 0) ? 0 : r->load[i - 1];
+        if (loadBefore + 1 > TRUCK_MAX_CAP) continue;
+
+        int prevX = 0, prevY = 0;
+        int tp;
+        if (i == 0) {
+            tp = first_time(px, py);
+        } else {
+            stop_cell(r->stops[i - 1], &prevX, &prevY);
+            tp = step_time(r->time[i - 1], prevX, prevY, px, py);
+        }
+        if (tp < pk->arrival_turn) tp = pk->arrival_turn;
+
+        // Delay of the stops between pickup and dropoff.
+        int shift = 0;
+        if (i < n) {
+            int cx, cy;
+            stop_cell(r->stops[i], &cx, &cy);
+            int at = step_time(tp, px, py, cx, cy);
+            int ready = stop_ready(r->stops[i]);
+            if (at < ready) at = ready;
+            shift = at - r->time[i];
+            if (shift < 0) shift = 0;
+        }
+
+        int rangeMinSlack = INT_MAX, rangeMaxLoad = loadBefore;
+        int lastX = px, lastY = py, lastTime = tp;   // stop just before the drop
+        for (int j = i; j <= n && j - i <= DROP_WINDOW; j++) {
+            if (j > i) {
+                int k = j - 1;
+                if (r->load[k] > rangeMaxLoad) rangeMaxLoad = r->load[k];
+                int s = stop_slack(r, k);
+                if (s < rangeMinSlack) rangeMinSlack = s;
+                stop_cell(r->stops[k], &lastX, &lastY);
+                lastTime = r->time[k] + shift;
+            }
+            if (rangeMaxLoad + 1 > TRUCK_MAX_CAP) break;
+
+            int tq = step_time(lastTime, lastX, lastY, qx, qy);
+            int after = 0, newEnd = tq;
+            if (j < n) {
+                int cx, cy;
+                stop_cell(r->stops[j], &cx, &cy);
+                int at = step_time(tq, qx, qy, cx, cy);
+                int ready = stop_ready(r->stops[j]);
+                if (at < ready) at = ready;
+                after = at - r->time[j];
+                if (after < 0) after = 0;
+                newEnd = route_end(r) + after;
+            }
+
+            int late = (tq > pk->expiry_turn)
+                     + (j > i && rangeMinSlack < shift)
+                     + (j < n && sufMin[j] < after);
+            int added = newEnd - route_end(r);
+            int overMakespan = newEnd > makespan ? newEnd - makespan : 0;
+            long cost = (long)late * LATE_COST + added + (long)overMakespan * 4 + (tq - pk->arrival_turn);
+
+            if (cost < best->cost) {
+                best->cost = cost;
+                best->truck = t;
+                best->pickAt = i;
+                best->dropAt = j;
+            }
+        }
+    }
+}
+
+static int makespan_of(void) {
+    int m = 0;
+    for (int t = 0; t < D; t++) {
+        if (route_end(&routes[t]) > m) m = route_end(&routes[t]);
+    }
+    return m;
+}
+
+// Truck indices sorted by model distance to the package's pickup when it
+// arrives; the first CANDIDATE_TRUCKS are tried.
+static int candidate_cmp_key[MAX_TRUCKS];
+static int candidate_cmp(const void *a, const void *b) {
+    int ka = candidate_cmp_key[*(const int *)a], kb = candidate_cmp_key[*(const int *)b];
+    if (ka != kb) return ka - kb;
+    return *(const int *)a - *(const int *)b;
+}
+
+static void insert_package(int p, int *sufMin) {
+    PackageRequest *pk = &pkgs[p];
+    int order[MAX_TRUCKS];
+    for (int t = 0; t < D; t++) {
+        int x, y;
+        route_position_at(&routes[t], pk->arrival_turn, &x, &y);
+        int free = route_end(&routes[t]) - pk->arrival_turn;
+        candidate_cmp_key[t] = manhattan(x, y, pk->pickup_x, pk->pickup_y) + (free > 0 ? free : 0);
+        order[t] = t;
+    }
+    qsort(order, D, sizeof(int), candidate_cmp);
+
+    int makespan = makespan_of();
+    Insertion best = {LONG_MAX, -1, 0, 0};
+    int tries = D < CANDIDATE_TRUCKS ? D : CANDIDATE_TRUCKS;
+    for (int k = 0; k < tries; k++) {
+        best_insertion(order[k], p, makespan, sufMin, &best);
+    }
+    if (best.truck < 0) {
+        // Every candidate is full all along: append to the emptiest route.
+        best.truck = order[0];
+        best.pickAt = best.dropAt = routes[order[0]].n;
+    }
+
+    Route *r = &routes[best.truck];
+    route_insert_at(r, best.dropAt, (Stop){p, 0});
+    route_insert_at(r, best.pickAt, (Stop){p, 1});
+    route_retime(r);
+    routeOf[p] = best.truck;
+}
+
+// ---- Turn-by-turn run of the routes under the helper's rules ----
+
+// One step towards (tx,ty) that shortens the distance, avoiding toll
+// cells where the other shortening step is free.
+static void step_towards(int *x, int *y, int tx, int ty) {
+    int cand[2][2], n = 0;
+    if (tx != *x) {
+        cand[n][0] = *x + (tx > *x ? 1 : -1);
+        cand[n][1] = *y;
+        n++;
+    }
+    if (ty != *y) {
+        cand[n][0] = *x;
+        cand[n][1] = *y + (ty > *y ? 1 : -1);
+        n++;
+    }
+    int pick = 0;
+    if (n == 2) {
+        int atTarget0 = cand[0][0] == tx && cand[0][1] == ty;
+        int atTarget1 = cand[1][0] == tx && cand[1][1] == ty;
+        int c0 = atTarget0 ? 0 : tollCost[cand[0][0]][cand[0][1]];
+        int c1 = atTarget1 ? 0 : tollCost[cand[1][0]][cand[1][1]];
+        if (c1 < c0) pick = 1;
+    }
+    *x = cand[pick][0];
+    *y = cand[pick][1];
+}
+
+static void simulate(int *turns, int *expired) {
+    int pos[MAX_TRUCKS][2], next[MAX_TRUCKS], wait[MAX_TRUCKS];
+    static int deliveredTurn[MAX_TOTAL_PACKAGES];
+    int remaining = R;
+    for (int t = 0; t < D; t++) {
+        pos[t][0] = pos[t][1] = 0;
+        next[t] = 0;
+        wait[t] = 0;
+    }
+
+    int turn = 0;
+    while (remaining > 0) {
+        turn++;
+        for (int t = 0; t < D; t++) {
+            Route *r = &routes[t];
+            int inToll = wait[t] > 0;
+            if (inToll) wait[t]--;
+
+            // One drop, then one pickup; a package dropped this turn is
+            // not picked up again, and no stop list drops and picks the
+            // same package back to back.
+            if (next[t] < r->n && !r->stops[next[t]].pickup) {
+                int cx, cy;
+                stop_cell(r->stops[next[t]], &cx, &cy);
+                if (pos[t][0] == cx && pos[t][1] == cy) {
+                    deliveredTurn[r->stops[next[t]].pkg] = turn;
+                    remaining--;
+                    next[t]++;
+                }
+            }
+            if (next[t] < r->n && r->stops[next[t]].pickup) {
+                int cx, cy;
+                Stop s = r->stops[next[t]];
+                stop_cell(s, &cx, &cy);
+                if (pos[t][0] == cx && pos[t][1] == cy && pkgs[s.pkg].arrival_turn <= turn) {
+                    next[t]++;
+                }
+            }
+
+            if (inToll || next[t] >= r->n) continue;
+            int tx, ty;
+            stop_cell(r->stops[next[t]], &tx, &ty);
+            if (pos[t][0] == tx && pos[t][1] == ty) continue;
+            step_towards(&pos[t][0], &pos[t][1], tx, ty);
+            wait[t] = tollCost[pos[t][0]][pos[t][1]];
+        }
+    }
+
+    *turns = turn;
+    *expired = 0;
+    for (int i = 0; i < R; i++) {
+        if (deliveredTurn[i] > pkgs[i].expiry_turn) (*expired)++;
+    }
+}
+
+int main(int argc, char *argv[]) {
+    if (argc < 2) {
+        printf("Usage: %s testcase.txt [-r rounds]\n", argv[0]);
+        return 1;
+    }
+    int rounds = DEFAULT_ROUNDS;
+    if (argc >= 4 && strcmp(argv[2], "-r") == 0) rounds = atoi(argv[3]);
+
+    FILE *fp = fopen(argv[1], "r");
+    if (fp == NULL) {
+        perror("Error opening testcase file");
+        return 1;
+    }
+    if (fscanf(fp, "%d %d %d %d %d %d", &N, &D, &S, &T, &B, &R) != 6 ||
+        N > MAX_GRID_SIZE || D > MAX_TRUCKS || D < 1 || R > MAX_TOTAL_PACKAGES) {
+        printf("Error: %s is not a testcase within compiled limits.\n", argv[1]);
+        fclose(fp);
+        return 1;
+    }
+    for (int i = 0; i < R; i++) {
+        int x1, y1, x2, y2, expiry, arrival;
+        if (fscanf(fp, "%d %d %d %d %d %d", &x1, &y1, &x2, &y2, &expiry, &arrival) != 6) {
+            printf("Error: %s ends before package %d.\n", argv[1], i);
+            fclose(fp);
+            return 1;
+        }
+        pkgs[i] = (PackageRequest){i, x1, y1, x2, y2, arrival, expiry + arrival};
+    }
+    for (int i = 0; i < B; i++) {
+        int x, y, cost;
+        if (fscanf(fp, "%d %d %d", &x, &y, &cost) == 3) tollCost[x][y] = cost;
+    }
+    fclose(fp);
+
+    int lbTurns, lbExpired;
+    lower_bounds(&lbTurns, &lbExpired);
+    printf("Lower bound: %d turns, %d expired packages\n", lbTurns, lbExpired);
+
+    // Packages are stored in arrival order, as in every testcase file.
+    routes = calloc(D, sizeof(Route));
+    int *sufMin = malloc((2 * R + 1) * sizeof(int));
+    for (int p = 0; p < R; p++) {
+        insert_package(p, sufMin);
+    }
+
+    // The model only approximates a run, so every round is run for real
+    // and the best one is reported.
+    int refTurns, refExpired;
+    simulate(&refTurns, &refExpired);
+    for (int round = 0; round < rounds; round++) {
+        for (int p = 0; p < R; p++) {
+            route_remove_pkg(&routes[routeOf[p]], p);
+            insert_package(p, sufMin);
+        }
+        int turns, expired;
+        simulate(&turns, &expired);
+        if (expired < refExpired || (expired == refExpired && turns < refTurns)) {
+            refTurns = turns;
+            refExpired = expired;
+        }
+    }
+    printf("Reference planner: %d turns, %d expired packages\n", refTurns, refExpired);
+
+    for (int t = 0; t < D; t++) {
+        free(routes[t].stops);
+        free(routes[t].time);
+        free(routes[t].load);
+    }
+    free(routes);
+    free(sufMin);
+    return 0;
+}
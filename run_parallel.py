@@ -0,0 +1,120 @@
+import argparse
+import os
+import re
+import shutil
+import subprocess
+import sys
+import tempfile
+from concurrent.futures import ThreadPoolExecutor
+
+# Runs many testcases at once. Every run gets its own working directory
+# (so input.txt, solution.log and friends never collide) and a private copy
+# of its testcase, because the helper deletes the file it reads.
+
+TURNS_RE = re.compile(r"took (\d+) turns, and had a total of (\d+) expired packages")
+SECONDS_RE = re.compile(r"took ([0-9.]+) seconds")
+BOUND_RE = re.compile(r"^Lower bound: (\d+) turns, (\d+) expired", re.M)
+REFERENCE_RE = re.compile(r"^Reference planner: (\d+) turns, (\d+) expired", re.M)
+
+
+def bounds_for(testcase, args):
+    """Lower bound and reference (turns, expired) from planbound, or None."""
+    try:
+        output = subprocess.run([os.path.abspath(args.bounds), testcase], capture_output=True,
+                                text=True, timeout=args.timeout).stdout
+    except subprocess.TimeoutExpired:
+        return None
+    bound, reference = BOUND_RE.search(output), REFERENCE_RE.search(output)
+    if bound is None or reference is None:
+        return None
+    return tuple(map(int, bound.groups())), tuple(map(int, reference.groups()))
+
+
+def run_helper(command, cwd, env, timeout):
+    """Combined output of one helper run, with a TIMEOUT line if it overran."""
+    proc = subprocess.Popen(command, cwd=cwd, env=env, stdout=subprocess.PIPE,
+                            stderr=subprocess.STDOUT, text=True)
+    try:
+        output, _ = proc.communicate(timeout=timeout)
+    except subprocess.TimeoutExpired:
+        # SIGTERM lets the helper kill the student and remove its IPC
+        # objects; SIGKILL only if it does not manage that in time.
+        proc.terminate()
+        try:
+            output, _ = proc.communicate(timeout=10)
+        except subprocess.TimeoutExpired:
+            proc.kill()
+            output, _ = proc.communicate()
+        output += f"\nTIMEOUT after {timeout}s\n"
+    return output
+
+
+def run_one(index, testcase, args):
+    name = os.path.splitext(os.path.basename(testcase))[0]
+    run_dir = tempfile.mkdtemp(prefix=f"{index:04d}-{name}-", dir=args.work_dir)
+    shutil.copy(testcase, os.path.join(run_dir, "testcase.txt"))
+
+    env = dict(os.environ, SOLUTION_BIN=os.path.abspath(args.solution))
+    output = run_helper([os.path.abspath(args.helper), "-f", "testcase.txt"], run_dir, env, args.timeout)
+
+    with open(os.path.join(run_dir, "helper.out"), "w") as file:
+        file.write(output)
+
+    turns = TURNS_RE.search(output)
+    seconds = SECONDS_RE.search(output)
+    ok = turns is not None and "successfully complete" in output
+    result = {
+        "testcase": testcase,
+        "ok": ok,
+        "turns": int(turns.group(1)) if turns else None,
+        "expired": int(turns.group(2)) if turns else None,
+        "seconds": float(seconds.group(1)) if seconds else None,
+        "dir": run_dir,
+        "bounds": bounds_for(testcase, args) if args.bounds else None,
+    }
+
+    if ok and not args.keep:
+        shutil.rmtree(run_dir, ignore_errors=True)
+    return result
+
+
+def main():
+    parser = argparse.ArgumentParser(description="Run testcases concurrently, each in its own directory.")
+    parser.add_argument("testcases", nargs="+", help="testcase files")
+    parser.add_argument("-j", "--jobs", type=int, default=os.cpu_count(), help="concurrent runs")
+    parser.add_argument("--helper", default="./helper", help="helper binary")
+    parser.add_argument("--solution", default="./solution", help="solution binary")
+    parser.add_argument("--work-dir", default="runs", help="parent of the per-run directories")
+    parser.add_argument("--timeout", type=float, default=600, help="seconds per run")
+    parser.add_argument("--keep", action="store_true", help="keep run directories of passing runs")
+    parser.add_argument("--bounds", metavar="PLANBOUND",
+                        help="also report lower bounds and the reference planner from this planbound binary")
+    args = parser.parse_args()
+
+    os.makedirs(args.work_dir, exist_ok=True)
+    with ThreadPoolExecutor(max_workers=args.jobs) as pool:
+        futures = [pool.submit(run_one, i, t, args) for i, t in enumerate(args.testcases)]
+        results = [f.result() for f in futures]
+
+    failed = 0
+    header = f"{'testcase':<30} {'status':<6} {'turns':>7} {'expired':>8} {'seconds':>9}"
+    if args.bounds:
+        header += f" {'lb turns':>9} {'lb exp':>7} {'ref turns':>10} {'ref exp':>8}"
+    print(header)
+    for r in results:
+        failed += not r["ok"]
+        line = (f"{r['testcase']:<30} {'ok' if r['ok'] else 'FAIL':<6} "
+                f"{r['turns'] if r['turns'] is not None else '-':>7} "
+                f"{r['expired'] if r['expired'] is not None else '-':>8} "
+                f"{r['seconds'] if r['seconds'] is not None else '-':>9}")
+        if args.bounds:
+            (lb_turns, lb_expired), (ref_turns, ref_expired) = r["bounds"] or (("-", "-"), ("-", "-"))
+            line += f" {lb_turns:>9} {lb_expired:>7} {ref_turns:>10} {ref_expired:>8}"
+        print(line)
+        if not r["ok"]:
+            print(f"    output kept in {r['dir']}")
+    sys.exit(1 if failed else 0)
+
+
+if __name__ == "__main__":
+    main()
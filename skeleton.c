@@ -5,6 +5,9 @@
 #include <stdlib.h>
 #include <string.h>
 #include <errno.h>
+#include <pthread.h>
+#include <semaphore.h>
+#include <stdatomic.h>
 #include <sys/ipc.h>
 #include <sys/shm.h>
 #include <sys/msg.h>
@@ -14,6 +17,7 @@
 #define TRUCK_MAX_CAP       20
 #define MAX_NEW_REQUESTS    50
 #define MAX_TOTAL_PACKAGES  5000
+#define MAX_CRACK_WORKERS   32
 
 // Directions
 #define MOVE_LEFT  'l'
@@ -109,13 +113,29 @@ typedef struct TruckInfo {
     int assignedPackageIds[TRUCK_MAX_CAP];
 } TruckInfo;
 
-// Simple queue of package indices for "unassigned" packages
-typedef struct PackageQueue {
-    int indices[MAX_TOTAL_PACKAGES];
-    int front;
-    int rear;
-    int size;
-} PackageQueue;
+// Package slots, indexed directly by package id.
+// Live slots are also kept in a dense array so per-turn loops only
+// touch packages that are still in play; delivered slots go back on
+// a free list.
+typedef struct PackageStore {
+    int slotOfId[MAX_TOTAL_PACKAGES];   // packageId -> slot, -1 if none
+    int freeSlots[MAX_TOTAL_PACKAGES];  // stack of unused slots
+    int freeCount;
+    int active[MAX_TOTAL_PACKAGES];     // dense list of live slots
+    int activePos[MAX_TOTAL_PACKAGES];  // slot -> index in active, -1 if free
+    int activeCount;
+} PackageStore;
+
+// One turn's auth jobs: trucks whose move is final and needs a string.
+// The planner is the only producer. Crack workers sleep on crackJobs,
+// which holds one token per published job, and take a job with a
+// fetch-add on `claimed`, so handing out jobs never takes a lock.
+typedef struct AuthQueue {
+    int trucks[MAX_TRUCKS];
+    atomic_int published;   // jobs [0, published) are visible to workers
+    atomic_int claimed;     // next job to hand out
+    atomic_int finished;    // jobs whose string is written (or given up on)
+} AuthQueue;
 
 // =========================
 //  GLOBALS (basic version)
@@ -129,7 +149,7 @@ static int B;          // toll booths (ignored for now)
 
 static key_t shmKey;
 static key_t mainMqKey;
-static key_t solverMqKeyBase;   // will be offset for each solver
+static key_t solverMqKeys[MAX_TRUCKS];  // one per solver, as listed in input.txt
 
 static int shmId;
 static int mainMqId;
@@ -138,52 +158,75 @@ static int solverMqIds[MAX_TRUCKS];  // up to D; we will only use S
 static MainSharedMemory *mainShmPtr = NULL;
 static TruckInfo trucks[MAX_TRUCKS];
 static PackageInfo packages[MAX_TOTAL_PACKAGES];
-static PackageQueue unassignedQueue;
+static PackageStore store;
+
+static AuthQueue authQueue;
+static pthread_t crackThreads[MAX_CRACK_WORKERS];
+static int crackWorkerCount;
+
+// Workers block in sem_wait until a job is posted. The lock is only taken
+// by a worker that finishes what was the last published job, to wake the
+// planner waiting in closeAuthQueueAndWait.
+static sem_t crackJobs;         // one token per published job
+static pthread_mutex_t crackLock = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t crackDone = PTHREAD_COND_INITIALIZER;
+static int crackShutdown;
 
 // =========================
 //  REGION 2: FUNCTIONS
 // =========================
 
-// ---- Helpers: queue & init ----
-void initPackageQueue(PackageQueue *q)
+// ---- Helpers: package store & init ----
+void initPackageStore(PackageStore *ps)
 {
-    q->front = 0;
-    q->rear = -1;
-    q->size = 0;
-};
+    ps->freeCount = 0;
+    ps->activeCount = 0;
 
-int isPackageQueueEmpty(PackageQueue *q)
-{
-    return (q->size == 0);
+    // Push in reverse so slots are handed out 0, 1, 2, ...
+    for (int i = MAX_TOTAL_PACKAGES - 1; i >= 0; i--) {
+        ps->slotOfId[i] = -1;
+        ps->activePos[i] = -1;
+        ps->freeSlots[ps->freeCount++] = i;
+    }
 };
 
-void enqueuePackage(PackageQueue *q, int pkgIndex)
+// Takes a free slot for packageId and marks it live. Returns the slot or -1.
+int allocPackageSlot(PackageStore *ps, int packageId)
 {
-    if (q->size >= MAX_TOTAL_PACKAGES) {
-        // queue overflow should never happen in valid test cases
-        return;
+    if (packageId < 0 || packageId >= MAX_TOTAL_PACKAGES || ps->freeCount == 0) {
+        return -1;
     }
-    q->rear = (q->rear + 1) % MAX_TOTAL_PACKAGES;
-    q->indices[q->rear] = pkgIndex;
-    q->size++;
+
+    int slot = ps->freeSlots[--ps->freeCount];
+    ps->slotOfId[packageId] = slot;
+    ps->activePos[slot] = ps->activeCount;
+    ps->active[ps->activeCount++] = slot;
+    return slot;
 };
 
-int dequeuePackage(PackageQueue *q)
+// Returns a delivered package's slot to the free list (swap-remove from active).
+void releasePackageSlot(PackageStore *ps, int slot)
 {
-    if (q->size == 0) {
-        return -1;
+    int pos = ps->activePos[slot];
+    if (pos == -1) {
+        return;
     }
-    int val = q->indices[q->front];
-    q->front = (q->front + 1) % MAX_TOTAL_PACKAGES;
-    q->size--;
-    return val;
+
+    int last = ps->active[--ps->activeCount];
+    ps->active[pos] = last;
+    ps->activePos[last] = pos;
+    ps->activePos[slot] = -1;
+
+    ps->slotOfId[packages[slot].packageId] = -1;
+    packages[slot].packageId = -1;
+    ps->freeSlots[ps->freeCount++] = slot;
 };
 
 
 void initLocalState()
 {
-    // --- Initialize unassigned queue ---
-    initPackageQueue(&unassignedQueue);
+    // --- Initialize package store ---
+    initPackageStore(&store);
 
     // --- Clear all package slots ---
     for (int i = 0; i < MAX_TOTAL_PACKAGES; i++) {
@@ -217,14 +260,9 @@ void initLocalState()
 
 int findPackageSlotById(int packageId)
 {
-    if (packageId < 0) return -1;
+    if (packageId < 0 || packageId >= MAX_TOTAL_PACKAGES) return -1;
 
-    for (int i = 0; i < MAX_TOTAL_PACKAGES; i++) {
-        if (packages[i].packageId == packageId) {
-            return i;
-        }
-    }
-    return -1;
+    return store.slotOfId[packageId];
 }; // returns index or -1
 
 // ---- Input & IPC setup ----
@@ -236,15 +274,24 @@ int readInputFile(const char *path)
         return 1;
     }
 
-    if (fscanf(fp, "%d %d %d %d %d %d %d %d",
+    if (fscanf(fp, "%d %d %d %d %d %d %d",
                &N, &D, &S, &T_last, &B,
-               &shmKey, &mainMqKey, &solverMqKeyBase) != 8)
+               &shmKey, &mainMqKey) != 7 || S < 1 || S > MAX_TRUCKS)
     {
         fprintf(stderr, "Invalid input.txt format\n");
         fclose(fp);
         return 1;
     }
 
+    // The solver keys are not consecutive: the helper lists each one.
+    for (int i = 0; i < S; i++) {
+        if (fscanf(fp, "%d", &solverMqKeys[i]) != 1) {
+            fprintf(stderr, "Invalid input.txt format: missing solver key %d\n", i);
+            fclose(fp);
+            return 1;
+        }
+    }
+
     fclose(fp);
     return 0;
 };
@@ -279,7 +326,7 @@ int setupMainMessageQueue()
 int setupSolverMessageQueues()
 {
     for (int i = 0; i < S; i++) {
-        key_t k = (key_t)(solverMqKeyBase + i);
+        key_t k = solverMqKeys[i];
 
         int mqid = msgget(k, 0);     // queues are already created by helper
         if (mqid == -1) {
@@ -315,13 +362,7 @@ void ingestNewPackagesIntoQueue(int newCount, int currentTurn)
         int idx = findPackageSlotById(pid);
 
         if (idx == -1) {
-            // Find a free slot
-            for (int j = 0; j < MAX_TOTAL_PACKAGES; j++) {
-                if (packages[j].packageId == -1) {
-                    idx = j;
-                    break;
-                }
-            }
+            idx = allocPackageSlot(&store, pid);
         }
 
         if (idx == -1) {
@@ -340,8 +381,6 @@ void ingestNewPackagesIntoQueue(int newCount, int currentTurn)
         packages[idx].assignedTruckId = -1;
         packages[idx].pickedUp = 0;
         packages[idx].delivered = 0;
-
-        enqueuePackage(&unassignedQueue, idx);
     }
 };
 
@@ -359,7 +398,7 @@ void assignPackagesSimple(int currentTurn)
 {
     (void) currentTurn;  // unused for now; kept for future optimizations
 
-    if (unassignedQueue.size == 0) {
+    if (store.activeCount == 0) {
         return;
     }
 
@@ -374,25 +413,10 @@ void assignPackagesSimple(int currentTurn)
         int bestPkgIdx = -1;
         int bestDist = 1000000000;  // effectively INF
 
-        int qSize = unassignedQueue.size;
-        int pos = unassignedQueue.front;
-
-        for (int k = 0; k < qSize; k++) {
-            int pkgIdx = unassignedQueue.indices[pos];
-            pos = (pos + 1) % MAX_TOTAL_PACKAGES;
-
-            if (pkgIdx < 0 || pkgIdx >= MAX_TOTAL_PACKAGES) {
-                continue;
-            }
-
+        for (int k = 0; k < store.activeCount; k++) {
+            int pkgIdx = store.active[k];
             PackageInfo *pkg = &packages[pkgIdx];
 
-            if (pkg->packageId == -1) {
-                continue;
-            }
-            if (pkg->delivered) {
-                continue;
-            }
             if (pkg->assignedTruckId != -1) {
                 continue;
             }
@@ -515,21 +539,12 @@ void decidePickDropForTruck(int truckId, int currentTurn)
         if (truck->onboardCount > 0) {
             truck->onboardPackageIds[0] = -1;
         }
-    }
-};
-void writeDecisionsToShared(int currentTurn)
-{
-    for (int t = 0; t < D; t++) {
-        decidePickDropForTruck(t, currentTurn);
 
-        char move = computeNextMoveForTruck(t, currentTurn);
-        mainShmPtr->truckMovementInstructions[t] = move;
+        releasePackageSlot(&store, pkgIdx);
     }
 };
-
 // ---- Authorization guessing ----
-// for now: naive loop guessing a fixed dummy string of proper length
-// (we can refine later)
+// brute force through the truck's solver: at most 4^len guesses
 void setTargetTruckForSolver(int solverId, int truckId)
 {
     SolverRequest req;
@@ -544,33 +559,37 @@ void setTargetTruckForSolver(int solverId, int truckId)
     }
 };
 
+// Enumerates every string of requiredLen over "udlr" as a base-4 counter,
+// least significant letter first. Each step rewrites only the letters that
+// changed, directly in the request buffer, so nothing is rebuilt or allocated.
 void obtainAuthStringForTruck(int truckId, int solverId, int requiredLen)
 {
-    // For now only simple case: length = 1
-    if (requiredLen != 1) {
-        // Fallback: just fill with 'u'
-        mainShmPtr->authStrings[truckId][0] = 'u';
-        mainShmPtr->authStrings[truckId][1] = '\0';
+    static const char letters[4] = { 'u', 'd', 'l', 'r' };
+    char *out = mainShmPtr->authStrings[truckId];
+
+    if (requiredLen < 1 || requiredLen > TRUCK_MAX_CAP) {
+        out[0] = '\0';
         return;
     }
 
-    const char candidates[4] = { 'u', 'd', 'l', 'r' };
-
-    for (int i = 0; i < 4; i++) {
-
-        SolverRequest req;
-        req.mtype = 3;  // guess message
-        req.truckNumber = truckId;
+    SolverRequest req;
+    req.mtype = 3;  // guess message
+    req.truckNumber = truckId;
 
-        req.authStringGuess[0] = candidates[i];
-        req.authStringGuess[1] = '\0';
+    unsigned char digits[TRUCK_MAX_CAP];
+    for (int i = 0; i < requiredLen; i++) {
+        digits[i] = 0;
+        req.authStringGuess[i] = letters[0];
+    }
+    req.authStringGuess[requiredLen] = '\0';
 
+    while (1) {
         // send guess
         if (msgsnd(solverMqIds[solverId], &req,
                    sizeof(SolverRequest) - sizeof(long), 0) == -1)
         {
             fprintf(stderr, "msgsnd guess failed: %s\n", strerror(errno));
-            continue;
+            break;
         }
 
         // wait for solver response
@@ -581,41 +600,152 @@ void obtainAuthStringForTruck(int truckId, int solverId, int requiredLen)
         {
             fprintf(stderr, "msgrcv solver response failed: %s\n",
                     strerror(errno));
-            continue;
+            break;
         }
 
         if (resp.guessIsCorrect == 1) {
             // correct auth
-            mainShmPtr->authStrings[truckId][0] = candidates[i];
-            mainShmPtr->authStrings[truckId][1] = '\0';
+            memcpy(out, req.authStringGuess, requiredLen + 1);
             return;
         }
+
+        // next candidate: carry through the letters that wrap to 'u'
+        int i = 0;
+        while (i < requiredLen && digits[i] == 3) {
+            digits[i] = 0;
+            req.authStringGuess[i] = letters[0];
+            i++;
+        }
+        if (i == requiredLen) {
+            break;  // every string of this length tried
+        }
+        digits[i]++;
+        req.authStringGuess[i] = letters[digits[i]];
     }
 
-    // If somehow none succeeded (should not happen)
-    mainShmPtr->authStrings[truckId][0] = 'u';
-    mainShmPtr->authStrings[truckId][1] = '\0';
+    // No match (or the solver went away): the helper will reject this,
+    // so stay put instead of moving.
+    out[0] = '\0';
+    mainShmPtr->truckMovementInstructions[truckId] = MOVE_STAY;
 };
 
-void fillAuthStringsForMovingTrucks(int currentTurn)
+// ---- Pipelined auth cracking ----
+// Each truck's move is final as soon as writeDecisionsToShared has decided
+// it, so its auth job goes to the crack workers right then instead of
+// after the whole fleet is planned. Planning and cracking overlap and a
+// turn takes about max(planning, cracking) instead of their sum.
+void publishAuthJob(int truckId)
 {
-    (void) currentTurn; // not needed for simple version
+    int n = atomic_load_explicit(&authQueue.published, memory_order_relaxed);
+    authQueue.trucks[n] = truckId;
+    atomic_store_explicit(&authQueue.published, n + 1, memory_order_release);
+    sem_post(&crackJobs);
+};
 
-    for (int t = 0; t < D; t++) {
+// Called once per crackJobs token. Every token stands for a published job
+// and no two claims share one, so there is always a job to return. Taking
+// the token synchronizes with the posts before it, so trucks[next] is set.
+int claimAuthJob()
+{
+    int next = atomic_fetch_add_explicit(&authQueue.claimed, 1, memory_order_relaxed);
+    return authQueue.trucks[next];
+};
+
+// Worker w owns solver w, so its retarget and guesses never interleave
+// with another worker's.
+void *crackWorker(void *arg)
+{
+    int solverId = (int)(long) arg;
 
-        char move = mainShmPtr->truckMovementInstructions[t];
-        if (move == MOVE_STAY) {
-            continue;   // no auth needed
+    while (1) {
+        while (sem_wait(&crackJobs) == -1 && errno == EINTR) {
+        }
+        if (crackShutdown) {
+            return NULL;
         }
 
-        int solverId = t % S;
+        int truckId = claimAuthJob();
+        setTargetTruckForSolver(solverId, truckId);
+        obtainAuthStringForTruck(truckId, solverId, mainShmPtr->truckPackageCount[truckId]);
+
+        // If more jobs get published after this check, the one that
+        // finishes last sees the count match and does the wake-up.
+        int done = atomic_fetch_add_explicit(&authQueue.finished, 1, memory_order_acq_rel) + 1;
+        if (done == atomic_load_explicit(&authQueue.published, memory_order_acquire)) {
+            pthread_mutex_lock(&crackLock);
+            pthread_cond_signal(&crackDone);
+            pthread_mutex_unlock(&crackLock);
+        }
+    }
+};
 
-        setTargetTruckForSolver(solverId, t);
+int startCrackWorkers()
+{
+    crackWorkerCount = S < MAX_CRACK_WORKERS ? S : MAX_CRACK_WORKERS;
+    if (sem_init(&crackJobs, 0, 0) == -1) {
+        fprintf(stderr, "sem_init crack jobs failed: %s\n", strerror(errno));
+        crackWorkerCount = 0;
+        return 1;
+    }
+    for (int w = 0; w < crackWorkerCount; w++) {
+        if (pthread_create(&crackThreads[w], NULL, crackWorker, (void *)(long) w) != 0) {
+            fprintf(stderr, "pthread_create crack worker failed\n");
+            crackWorkerCount = w;
+            return 1;
+        }
+    }
+    return 0;
+};
 
-        // Since only one package in our current version:
-        int requiredLen = 1;
+void stopCrackWorkers()
+{
+    crackShutdown = 1;
+    for (int w = 0; w < crackWorkerCount; w++) {
+        sem_post(&crackJobs);
+    }
+    for (int w = 0; w < crackWorkerCount; w++) {
+        pthread_join(crackThreads[w], NULL);
+    }
+    sem_destroy(&crackJobs);
+};
+
+// Empties the queue for this turn's jobs. Last turn's jobs are all
+// finished, so every token was taken and every job claimed: no worker is
+// between sem_wait and claimAuthJob while the counters are reset.
+void openAuthQueue()
+{
+    atomic_store(&authQueue.published, 0);
+    atomic_store(&authQueue.claimed, 0);
+    atomic_store(&authQueue.finished, 0);
+};
 
-        obtainAuthStringForTruck(t, solverId, requiredLen);
+// No more jobs this turn; sleeps until every published one has its string
+// written (or its truck told to stay).
+void closeAuthQueueAndWait()
+{
+    int published = atomic_load_explicit(&authQueue.published, memory_order_relaxed);
+
+    pthread_mutex_lock(&crackLock);
+    while (atomic_load_explicit(&authQueue.finished, memory_order_acquire) < published) {
+        pthread_cond_wait(&crackDone, &crackLock);
+    }
+    pthread_mutex_unlock(&crackLock);
+};
+
+void writeDecisionsToShared(int currentTurn)
+{
+    for (int t = 0; t < D; t++) {
+        decidePickDropForTruck(t, currentTurn);
+
+        char move = computeNextMoveForTruck(t, currentTurn);
+        mainShmPtr->truckMovementInstructions[t] = move;
+
+        // The helper generated this turn's string from the load it
+        // reported at the start of the turn; staying or empty trucks
+        // need none and skip the queue.
+        if (move != MOVE_STAY && mainShmPtr->truckPackageCount[t] > 0) {
+            publishAuthJob(t);
+        }
     }
 };
 
@@ -638,12 +768,7 @@ int mainLoop()
 {
     while (1) {
 
-        // Step 1: Announce ready for next turn
-        if (sendTurnReady() != 0) {
-            return 1;
-        }
-
-        // Step 2: Receive turn-change info
+        // Step 1: Receive turn-change info; the helper opens every turn
         TurnChangeResponse resp;
         if (readTurnChange(&resp) != 0) {
             return 1;
@@ -656,22 +781,30 @@ int mainLoop()
             break;
         }
 
-        // Step 3: Sync truck positions from shared memory
+        // Step 2: Sync truck positions from shared memory
         syncTruckPositionsFromShared();
 
-        // Step 4: Ingest new packages for this turn
+        // Step 3: Ingest new packages for this turn
         if (resp.newPackageRequestCount > 0) {
             ingestNewPackagesIntoQueue(resp.newPackageRequestCount, turn);
         }
 
-        // Step 5: Assign packages (nearest-package single-assignment rule)
+        // Step 4: Assign packages (nearest-package single-assignment rule)
         assignPackagesSimple(turn);
 
-        // Step 6: Determine movements + pickup/drop commands
+        // Step 5: Determine movements + pickup/drop commands; each
+        // moving, loaded truck is handed to the crack workers as soon
+        // as its move is decided
+        openAuthQueue();
         writeDecisionsToShared(turn);
 
-        // Step 7: Fill authorization strings for moving trucks
-        fillAuthStringsForMovingTrucks(turn);
+        // Step 6: Wait for the authorization strings still being cracked
+        closeAuthQueueAndWait();
+
+        // Step 7: Decisions are in shared memory; let the helper run the turn
+        if (sendTurnReady() != 0) {
+            return 1;
+        }
     }
 
     return 0;
@@ -704,11 +837,18 @@ int main(void) {
 
     initLocalState();
 
+    if (startCrackWorkers() != 0) {
+        fprintf(stderr, "Failed to start crack workers\n");
+        return 1;
+    }
+
     if (mainLoop() != 0) {
         fprintf(stderr, "Error inside main loop\n");
         return 1;
     }
 
+    stopCrackWorkers();
+
     // detach shared memory on exit
     if (mainShmPtr != NULL) {
         shmdt(mainShmPtr);
@@ -6,15 +6,31 @@
 #include <sys/ipc.h>
 #include <sys/shm.h>
 #include <sys/msg.h>
+#include <sys/socket.h>
 #include <unistd.h>
 #include <limits.h>
+#include <pthread.h>
+#include <stdatomic.h>
+#include <time.h>
+#include <stdint.h>
+#include <stddef.h>
+
+#include "eventlog.h"
 
 
 #define MAX_TRUCKS 250
+#define MAX_SOLVERS 250
 #define TRUCK_MAX_CAP 20
 #define MAX_NEW_REQUESTS 50
 #define MAX_TOTAL_PACKAGES 5000
 
+// Triage classes (see triagePackages)
+#define TRIAGE_AT_RISK     0   // saveable, but only just
+#define TRIAGE_OVERDUE     1   // unsaveable and waited too long: served like normal, oldest first
+#define TRIAGE_NORMAL      2   // comfortable slack
+#define TRIAGE_UNSAVEABLE  3   // best ETA already past expiry: background service
+#define AT_RISK_SLACK      8   // slack (turns) at or below which a package is at risk
+#define BACKGROUND_MAX_WAIT 100 // turns since arrival an unsaveable package waits for an idle truck
 
 
 
@@ -31,6 +47,20 @@ typedef struct PackageRequest {
     int expiry_turn;    // turn at which request expires
 } PackageRequest;
 
+//Queued Turns - run by the helper without waking us
+#define PLAN_MAX_TURNS 16
+#define PLAN_STOP_TOLL 1
+
+typedef struct TurnPlan {
+    int length;                          // queued turns, 0 for none
+    int stopOn;                          // PLAN_STOP_* events that end the plan
+    char truckMovementInstructions[PLAN_MAX_TURNS][MAX_TRUCKS];
+    int pickUpCommands[PLAN_MAX_TURNS][MAX_TRUCKS];
+    int dropOffCommands[PLAN_MAX_TURNS][MAX_TRUCKS];
+    int executed;                        // queued turns run before this wake-up
+    int stopReason;                      // why the plan ended (helper.h PLAN_*)
+} TurnPlan;
+
 //Main Shared Memory 
 typedef struct MainSharedMemory {
 
@@ -48,6 +78,8 @@ typedef struct MainSharedMemory {
 
     int packageLocations[MAX_TOTAL_PACKAGES][2]; // (x,y) of each package (-1,-1 if not on grid)
 
+    TurnPlan plan;                       // queued turns, see helper.h
+
 } MainSharedMemory;
 
 //Turn Change Response - Main MQ
@@ -77,11 +109,36 @@ typedef struct SolverResponse {
     int guessIsCorrect; // 1 = correct, 0 = incorrect
 } SolverResponse;
 
+//Packed Guesses - many candidates per message, told apart by size (helper.h)
+#define PACKED_GUESS_MAX 256
+#define PACK_GUESS(truck, length, letters) \
+    (((unsigned long long)(truck) << 45) | ((unsigned long long)(length) << 40) | (unsigned long long)(letters))
+
+typedef struct PackedGuessRequest {
+    long mtype;                                   // 3
+    int count;
+    unsigned long long guesses[PACKED_GUESS_MAX];
+} PackedGuessRequest;
+
+typedef struct PackedGuessResponse {
+    long mtype;                                   // 4
+    unsigned long long hits[PACKED_GUESS_MAX / 64]; // bit k: guess k was right
+} PackedGuessResponse;
+
 //Packages Information and Unassigned Status 
 typedef struct {
     int used;              // 1 if this slot is used
     int assignedToTruck;   // -1 if not yet assigned, otherwise truck id
     PackageRequest pkg;    // full package data
+    int delivered;         // 1 once dropped at its destination
+    int slack;             // expiry_turn - best achievable ETA (last triage pass)
+    int triage;            // TRIAGE_* class (last triage pass)
+    int relayLeg;          // 1 while pkg.dropoff_* is a transfer cell
+    int finalX, finalY;    // real destination while relayLeg is set
+    int relays;            // handoffs planned so far
+    int droppedTurn;       // turn of the last handoff drop, -1 if none
+    int etaTruck;          // truck behind bestEta, -1 to force a full triage scan
+    int bestEta;           // best dropoff turn any truck offered (last triage pass)
 } PackageInfo;
 
 
@@ -104,35 +161,535 @@ typedef struct {
     int assignedCount;
     int assignedPackageIds[TRUCK_MAX_CAP];
 
+    int turnsInToll;             // turns left waiting at a toll booth
+
 } TruckInfo;
 
+//Event Log
+//
+// Turn-loop tracing goes into an in-memory ring of binary LogRecords
+// instead of stdout. The turn loop is the only producer and never blocks:
+// if the ring is full the record is counted as dropped. A background
+// thread drains the ring to the log file; log_flush() drains on demand.
+// Decode the file with ./logdecode.
+
+#ifndef LOG_LEVEL
+#define LOG_LEVEL LOG_LEVEL_INFO
+#endif
+
+#define LOG_RING_SIZE     65536   // records, power of two
+#define LOG_FLUSH_NSEC    2000000 // background drain period
+#define LOG_DEFAULT_PATH  "solution.log"
+
+static LogRecord logRing[LOG_RING_SIZE];
+static _Atomic unsigned long logHead;     // next slot the producer writes
+static _Atomic unsigned long logTail;     // next slot the consumer reads
+static _Atomic unsigned long logDropped;
+static atomic_int logRunning;
+static pthread_mutex_t logDrainLock = PTHREAD_MUTEX_INITIALIZER;
+static pthread_t logThread;
+static FILE *logFile;
+static int logTurn;
+
+void log_emit(int type, int truck, const int a[LOG_ARGS]) {
+    unsigned long head = atomic_load_explicit(&logHead, memory_order_relaxed);
+    unsigned long tail = atomic_load_explicit(&logTail, memory_order_acquire);
+    if (head - tail >= LOG_RING_SIZE) {
+        atomic_fetch_add_explicit(&logDropped, 1, memory_order_relaxed);
+        return;
+    }
+
+    LogRecord *r = &logRing[head & (LOG_RING_SIZE - 1)];
+    r->type = (uint16_t)type;
+    r->truck = (int16_t)truck;
+    r->turn = logTurn;
+    memcpy(r->a, a, sizeof(r->a));
+
+    atomic_store_explicit(&logHead, head + 1, memory_order_release);
+}
+
+// Package ids travel as a run of EV_ID_CHUNK records.
+void log_ids(const int ids[], int n) {
+    for (int i = 0; i < n; i += LOG_CHUNK_IDS) {
+        int a[LOG_ARGS] = {0};
+        a[0] = (n - i < LOG_CHUNK_IDS) ? n - i : LOG_CHUNK_IDS;
+        for (int k = 0; k < a[0]; k++) a[1 + k] = ids[i + k];
+        log_emit(EV_ID_CHUNK, -1, a);
+    }
+}
+
+#if LOG_LEVEL >= LOG_LEVEL_INFO
+#define LOG_INFO(type, truck, ...) log_emit((type), (truck), (const int[LOG_ARGS]){__VA_ARGS__})
+#else
+#define LOG_INFO(type, truck, ...) ((void)0)
+#endif
+
+#if LOG_LEVEL >= LOG_LEVEL_DEBUG
+#define LOG_DEBUG(type, truck, ...) log_emit((type), (truck), (const int[LOG_ARGS]){__VA_ARGS__})
+#define LOG_DEBUG_IDS(ids, n) log_ids((ids), (n))
+#else
+#define LOG_DEBUG(type, truck, ...) ((void)0)
+#define LOG_DEBUG_IDS(ids, n) ((void)0)
+#endif
+
+// Write everything published so far. Safe from any thread.
+void log_flush(void) {
+    pthread_mutex_lock(&logDrainLock);
+
+    unsigned long tail = atomic_load_explicit(&logTail, memory_order_relaxed);
+    unsigned long head = atomic_load_explicit(&logHead, memory_order_acquire);
+    while (tail != head) {
+        unsigned long idx = tail & (LOG_RING_SIZE - 1);
+        unsigned long run = head - tail;
+        if (run > LOG_RING_SIZE - idx) run = LOG_RING_SIZE - idx;
+        if (logFile) fwrite(&logRing[idx], sizeof(LogRecord), run, logFile);
+        tail += run;
+    }
+    atomic_store_explicit(&logTail, tail, memory_order_release);
+
+    unsigned long dropped = atomic_exchange(&logDropped, 0);
+    if (dropped > 0 && logFile) {
+        LogRecord r = {EV_DROPPED, -1, logTurn, {(int32_t)dropped}};
+        fwrite(&r, sizeof(r), 1, logFile);
+    }
+    if (logFile) fflush(logFile);
+
+    pthread_mutex_unlock(&logDrainLock);
+}
+
+#if LOG_LEVEL > LOG_LEVEL_NONE
+static void *log_flusher(void *arg) {
+    (void)arg;
+    struct timespec period = {0, LOG_FLUSH_NSEC};
+    while (atomic_load(&logRunning)) {
+        nanosleep(&period, NULL);
+        log_flush();
+    }
+    return NULL;
+}
+#endif
+
+void log_open(void) {
+#if LOG_LEVEL > LOG_LEVEL_NONE
+    const char *path = getenv("SOLUTION_LOG");
+    logFile = fopen(path ? path : LOG_DEFAULT_PATH, "wb");
+    if (!logFile) return;
+
+    LogFileHeader h = {LOG_MAGIC, sizeof(LogRecord), 0};
+    fwrite(&h, sizeof(h), 1, logFile);
+
+    atomic_store(&logRunning, 1);
+    if (pthread_create(&logThread, NULL, log_flusher, NULL) != 0) {
+        atomic_store(&logRunning, 0);
+    }
+#endif
+}
+
+void log_close(void) {
+    if (atomic_exchange(&logRunning, 0)) {
+        pthread_join(logThread, NULL);
+    }
+    log_flush();
+    if (logFile) {
+        fclose(logFile);
+        logFile = NULL;
+    }
+}
+
+//Profiler
+//
+// Lap timers over the phases of the turn loop: each PROF_LAP charges the
+// time since the previous lap to one phase, so one clock read per phase
+// boundary covers the whole turn. Samples go into log2-nanosecond
+// histograms next to a few work counters. The report is written to
+// solution.prof (SOLUTION_PROF overrides) at exit, and also every
+// PROFILE_EVERY turns when that variable is set. Build with -DPROFILE=0
+// to compile it away.
+
+#ifndef PROFILE
+#define PROFILE 1
+#endif
+
+#define PROF_BUCKETS      40      // bucket b holds samples in [2^b, 2^(b+1)) ns
+#define PROF_DEFAULT_PATH "solution.prof"
+
+typedef enum {
+    PH_WAIT,        // blocked in msgrcv for the next turn
+    PH_INGEST,      // newPackageRequests
+    PH_ORACLE,      // toll learning, relay sync, oracle turn bookkeeping
+    PH_READ,        // readTruckInfo
+    PH_TRIAGE,
+    PH_ASSIGN,      // assignPackagesToTrucks
+    PH_REPOSITION,  // idle repositioning
+    PH_ROLLOUT,     // route policy rollouts
+    PH_DECIDE,      // decide_truck_actions
+    PH_AUTH,        // auth cracking
+    PH_REPLY,       // TurnReady
+    PH_COUNT
+} ProfPhase;
+
+typedef enum {
+    CTR_GUESSES,     // auth candidates tested by solvers
+    CTR_RETARGETS,   // mtype 2 requests sent to solvers
+    CTR_CANDIDATES,  // package/truck pairs scored by assignment
+    CTR_TRIAGE_FULL, // packages triaged against the whole fleet
+    CTR_TRIAGE_KEPT, // packages that kept their cached triage
+    CTR_ZONE_MIGRATIONS, // trucks whose route end moved to another zone
+    CTR_ZONE_EXCHANGES,  // packages a zone handed to the whole-fleet pass
+    CTR_SOLVER_MESSAGES, // guess requests sent (one per round trip)
+    CTR_COUNT
+} ProfCounter;
+
+typedef struct PhaseStats {
+    uint64_t count, total, min, max;
+    uint64_t hist[PROF_BUCKETS];
+} PhaseStats;
+
+static const char *profPhaseNames[PH_COUNT] = {
+    "wait", "ingest", "oracle", "read", "triage", "assign",
+    "reposition", "rollout", "decide", "auth", "reply"
+};
+static const char *profCounterNames[CTR_COUNT] = {
+    "guesses sent", "solver retargets", "candidates scored",
+    "triage full scans", "triage kept", "zone migrations", "zone exchanges",
+    "guess messages"
+};
+
+static PhaseStats profPhases[PH_COUNT];
+static uint64_t profCounters[CTR_COUNT];
+static uint64_t profMark;
+static int profEvery;
+static int profTurns;
+static FILE *profFile;
+
+static inline uint64_t prof_now(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC_RAW, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ull + (uint64_t)ts.tv_nsec;
+}
+
+void prof_lap(int phase) {
+    uint64_t now = prof_now();
+    uint64_t ns = now - profMark;
+    profMark = now;
+
+    PhaseStats *ps = &profPhases[phase];
+    if (ps->count == 0 || ns < ps->min) ps->min = ns;
+    if (ns > ps->max) ps->max = ns;
+    ps->count++;
+    ps->total += ns;
+
+    int b = (ns == 0) ? 0 : 63 - __builtin_clzll(ns);
+    if (b >= PROF_BUCKETS) b = PROF_BUCKETS - 1;
+    ps->hist[b]++;
+}
+
+#if PROFILE
+#define PROF_LAP(phase)        prof_lap(phase)
+#define PROF_COUNT(counter, n) (profCounters[(counter)] += (uint64_t)(n))
+#else
+#define PROF_LAP(phase)        ((void)0)
+#define PROF_COUNT(counter, n) ((void)0)
+#endif
+
+// Upper edge of the bucket holding the q-th fraction of the samples.
+static double prof_quantile_us(const PhaseStats *ps, double q) {
+    uint64_t want = (uint64_t)(q * (double)ps->count);
+    uint64_t seen = 0;
+    for (int b = 0; b < PROF_BUCKETS; b++) {
+        seen += ps->hist[b];
+        if (seen > want) {
+            uint64_t edge = 2ull << b;
+            return (double)(edge < ps->max ? edge : ps->max) / 1000.0;
+        }
+    }
+    return (double)ps->max / 1000.0;
+}
+
+void prof_dump(const char *when) {
+    if (!profFile) return;
+
+    uint64_t all = 0;
+    for (int k = 0; k < PH_COUNT; k++) all += profPhases[k].total;
+
+    fprintf(profFile, "== %s, %d turns ==\n", when, profTurns);
+    fprintf(profFile, "%-11s %8s %10s %6s %10s %10s %10s %10s\n",
+            "phase", "count", "total ms", "share", "mean us", "p50 us", "p99 us", "max us");
+    for (int k = 0; k < PH_COUNT; k++) {
+        const PhaseStats *ps = &profPhases[k];
+        if (ps->count == 0) continue;
+        fprintf(profFile, "%-11s %8llu %10.2f %5.1f%% %10.1f %10.1f %10.1f %10.1f\n",
+                profPhaseNames[k], (unsigned long long)ps->count,
+                ps->total / 1e6, all ? 100.0 * ps->total / all : 0.0,
+                ps->total / 1e3 / ps->count,
+                prof_quantile_us(ps, 0.50), prof_quantile_us(ps, 0.99),
+                ps->max / 1e3);
+    }
+    for (int k = 0; k < CTR_COUNT; k++) {
+        fprintf(profFile, "%-18s %12llu\n", profCounterNames[k],
+                (unsigned long long)profCounters[k]);
+    }
+    fputc('\n', profFile);
+    fflush(profFile);
+}
+
+void prof_open(void) {
+    const char *every = getenv("PROFILE_EVERY");
+    profEvery = every ? atoi(every) : 0;
+    profMark = prof_now();
+#if PROFILE
+    const char *path = getenv("SOLUTION_PROF");
+    profFile = fopen(path ? path : PROF_DEFAULT_PATH, "w");
+#endif
+}
+
+// Called once per completed turn.
+void prof_turn_done(void) {
+    profTurns++;
+    if (profEvery > 0 && profTurns % profEvery == 0) {
+        char when[32];
+        snprintf(when, sizeof(when), "turn %d", profTurns);
+        prof_dump(when);
+    }
+}
+
+void prof_close(void) {
+    prof_dump("exit");
+    if (profFile) {
+        fclose(profFile);
+        profFile = NULL;
+    }
+}
+
+//Fleet Layout
+//
+// The fields every candidate scan reads (position, planned load, where the
+// current route ends and when) are kept as one contiguous array per field,
+// padded to a multiple of 32 trucks, so scoring one package against the
+// whole fleet streams through a few cache lines and vectorises cleanly.
+// TruckInfo keeps the onboard/assigned id lists.
+
+#define FLEET_PAD   256                      // MAX_TRUCKS (250) rounded up to a multiple of 32:
+                                             // every 32 lanes fill one capOk word and two
+                                             // 16-lane AVX2 steps
+#define FLEET_WORDS (FLEET_PAD / 32)
+#define FLEET_FULL  0x3fff                   // load of a padding lane
+
+// Coordinates (< 500), Manhattan distances (< 1000) and loads all fit in
+// 16 bits, which doubles the lanes per vector. busy can grow without bound
+// and is only read by the scalar refinement, so it stays 32-bit.
+typedef struct FleetSoA {
+    int16_t x[FLEET_PAD]    __attribute__((aligned(32)));
+    int16_t y[FLEET_PAD]    __attribute__((aligned(32)));
+    int16_t load[FLEET_PAD] __attribute__((aligned(32))); // onboard + assigned
+    int16_t endX[FLEET_PAD] __attribute__((aligned(32))); // where the route ends
+    int16_t endY[FLEET_PAD] __attribute__((aligned(32)));
+    int32_t busy[FLEET_PAD] __attribute__((aligned(32))); // turns until free at the end
+} FleetSoA;
+
+// Manhattan lower bounds for one package against every truck.
+typedef struct FleetScores {
+    int16_t toPickup[FLEET_PAD]    __attribute__((aligned(32))); // truck -> pickup
+    int16_t endToPickup[FLEET_PAD] __attribute__((aligned(32))); // route end -> pickup
+    uint32_t capOk[FLEET_WORDS];             // bit t set if load[t] < capLimit
+} FleetScores;
+
+static FleetSoA fleet;
+static int fleetOrder[FLEET_PAD];           // 0, 1, 2, ...: every truck as a candidate list
+
+void fleet_init(void) {
+    for (int t = 0; t < FLEET_PAD; t++) {
+        fleet.x[t] = fleet.y[t] = 0;
+        fleet.endX[t] = fleet.endY[t] = 0;
+        fleet.busy[t] = 0;
+        fleet.load[t] = FLEET_FULL;
+        fleetOrder[t] = t;
+    }
+}
+
+static int fleet_cap_ok(const FleetScores *s, int t) {
+    return (s->capOk[t >> 5] >> (t & 31)) & 1;
+}
+
+static void score_fleet_scalar(int px, int py, int D, int capLimit, FleetScores *s) {
+    int lanes = (D + 31) & ~31;
+
+    for (int t = 0; t < lanes; t++) {
+        s->toPickup[t] = (int16_t)(abs(fleet.x[t] - px) + abs(fleet.y[t] - py));
+        s->endToPickup[t] = (int16_t)(abs(fleet.endX[t] - px) + abs(fleet.endY[t] - py));
+    }
+    for (int w = 0; w < FLEET_WORDS; w++) {
+        uint32_t word = 0;
+        for (int k = 0; k < 32 && w * 32 + k < lanes; k++) {
+            word |= (uint32_t)(fleet.load[w * 32 + k] < capLimit) << k;
+        }
+        s->capOk[w] = word;
+    }
+}
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+
+__attribute__((target("sse4.1")))
+static void score_fleet_sse4(int px, int py, int D, int capLimit, FleetScores *s) {
+    int lanes = (D + 31) & ~31;
+    __m128i vpx = _mm_set1_epi16((short)px), vpy = _mm_set1_epi16((short)py);
+    __m128i vcap = _mm_set1_epi16((short)capLimit);
+
+    for (int t = 0; t < lanes; t += 8) {
+        __m128i x = _mm_load_si128((const __m128i *)&fleet.x[t]);
+        __m128i y = _mm_load_si128((const __m128i *)&fleet.y[t]);
+        __m128i d = _mm_add_epi16(_mm_abs_epi16(_mm_sub_epi16(x, vpx)),
+                                  _mm_abs_epi16(_mm_sub_epi16(y, vpy)));
+        _mm_store_si128((__m128i *)&s->toPickup[t], d);
+
+        __m128i ex = _mm_load_si128((const __m128i *)&fleet.endX[t]);
+        __m128i ey = _mm_load_si128((const __m128i *)&fleet.endY[t]);
+        __m128i e = _mm_add_epi16(_mm_abs_epi16(_mm_sub_epi16(ex, vpx)),
+                                  _mm_abs_epi16(_mm_sub_epi16(ey, vpy)));
+        _mm_store_si128((__m128i *)&s->endToPickup[t], e);
+    }
+    for (int t = 0; t < lanes; t += 32) {
+        uint32_t word = 0;
+        for (int k = 0; k < 32; k += 16) {
+            __m128i lo = _mm_cmplt_epi16(_mm_load_si128((const __m128i *)&fleet.load[t + k]), vcap);
+            __m128i hi = _mm_cmplt_epi16(_mm_load_si128((const __m128i *)&fleet.load[t + k + 8]), vcap);
+            word |= (uint32_t)_mm_movemask_epi8(_mm_packs_epi16(lo, hi)) << k;
+        }
+        s->capOk[t >> 5] = word;
+    }
+    for (int w = lanes >> 5; w < FLEET_WORDS; w++) s->capOk[w] = 0;
+}
+
+__attribute__((target("avx2")))
+static void score_fleet_avx2(int px, int py, int D, int capLimit, FleetScores *s) {
+    int lanes = (D + 31) & ~31;
+    __m256i vpx = _mm256_set1_epi16((short)px), vpy = _mm256_set1_epi16((short)py);
+    __m256i vcap = _mm256_set1_epi16((short)capLimit);
+
+    for (int t = 0; t < lanes; t += 16) {
+        __m256i x = _mm256_load_si256((const __m256i *)&fleet.x[t]);
+        __m256i y = _mm256_load_si256((const __m256i *)&fleet.y[t]);
+        __m256i d = _mm256_add_epi16(_mm256_abs_epi16(_mm256_sub_epi16(x, vpx)),
+                                     _mm256_abs_epi16(_mm256_sub_epi16(y, vpy)));
+        _mm256_store_si256((__m256i *)&s->toPickup[t], d);
+
+        __m256i ex = _mm256_load_si256((const __m256i *)&fleet.endX[t]);
+        __m256i ey = _mm256_load_si256((const __m256i *)&fleet.endY[t]);
+        __m256i e = _mm256_add_epi16(_mm256_abs_epi16(_mm256_sub_epi16(ex, vpx)),
+                                     _mm256_abs_epi16(_mm256_sub_epi16(ey, vpy)));
+        _mm256_store_si256((__m256i *)&s->endToPickup[t], e);
+    }
+    for (int t = 0; t < lanes; t += 32) {
+        __m256i lo = _mm256_cmpgt_epi16(vcap, _mm256_load_si256((const __m256i *)&fleet.load[t]));
+        __m256i hi = _mm256_cmpgt_epi16(vcap, _mm256_load_si256((const __m256i *)&fleet.load[t + 16]));
+        // packs interleaves 128-bit halves; restore truck order before movemask.
+        __m256i packed = _mm256_permute4x64_epi64(_mm256_packs_epi16(lo, hi), 0xd8);
+        s->capOk[t >> 5] = (uint32_t)_mm256_movemask_epi8(packed);
+    }
+    for (int w = lanes >> 5; w < FLEET_WORDS; w++) s->capOk[w] = 0;
+}
+#endif
+
+typedef void (*ScoreFleetFn)(int px, int py, int D, int capLimit, FleetScores *s);
+
+static ScoreFleetFn score_fleet = score_fleet_scalar;
+static const char *scoreFleetName = "scalar";
+
+// Pick the widest kernel the CPU supports. FLEET_KERNEL=scalar|sse4|avx2
+// in the environment narrows the choice (for comparing kernels).
+void fleet_select_kernel(void) {
+    const char *want = getenv("FLEET_KERNEL");
+#if defined(__x86_64__) || defined(__i386__)
+    __builtin_cpu_init();
+    if ((!want || strcmp(want, "avx2") == 0) && __builtin_cpu_supports("avx2")) {
+        score_fleet = score_fleet_avx2;
+        scoreFleetName = "avx2";
+        return;
+    }
+    if ((!want || strcmp(want, "scalar") != 0) && __builtin_cpu_supports("sse4.1")) {
+        score_fleet = score_fleet_sse4;
+        scoreFleetName = "sse4";
+        return;
+    }
+#endif
+    (void)want;
+    score_fleet = score_fleet_scalar;
+    scoreFleetName = "scalar";
+}
+
+//Incremental Replanning
+//
+// Most turns change little: trucks follow their routes and nothing new
+// arrives. Planning work is driven by events instead of being redone from
+// scratch every turn. The events are arrivals, pickups and drop-offs, toll
+// entries and exits seen through truckTurnsInToll, newly learned tolls, and
+// route choices whose deadline margin has run out. A truck an event touched
+// is dirty. Clean trucks keep their cached next target (decide_truck_actions).
+// A package keeps its cached best ETA unless the truck it relied on changed
+// (triagePackages). Rollouts are redone only when something happened.
+
+#define ROLLOUT_REFRESH 10   // turns between rollouts when nothing happens
+
+static unsigned char truckDirty[MAX_TRUCKS];
+static int worldDirty = 1;     // a toll was learned: every cached route is suspect
+static int planEvents = 1;     // events since the last rollout
+static int lastRolloutTurn;
+
+void mark_truck_dirty(int t) {
+    truckDirty[t] = 1;
+    planEvents++;
+}
+
+void mark_world_dirty(void) {
+    worldDirty = 1;
+    planEvents++;
+}
+
+void mark_package_dirty(PackageInfo *info) {
+    info->etaTruck = -1;
+    planEvents++;
+}
+
 //Helper Functions 
 
+// Onboard/assigned lists live across turns; only called once at startup.
+void initTruckInfo(int D, TruckInfo trucks[]) {
+    for (int t = 0; t < D; t++) {
+        trucks[t].id = t;
+        trucks[t].currentPackageCount = 0;
+        trucks[t].assignedCount = 0;
+        trucks[t].turnsInToll = 0;
+        fleet.load[t] = 0;
+
+        for (int i = 0; i < TRUCK_MAX_CAP; i++) {
+            trucks[t].packageIds[i] = -1;
+            trucks[t].assignedPackageIds[i] = -1;
+        }
+    }
+}
+
 void readTruckInfo(MainSharedMemory *shm,
                                 int D,
                                 TruckInfo trucks[]) {
     for (int t = 0; t < D; t++) {
+        // Entering a toll, or finishing the wait, changes the truck's timing.
+        if ((trucks[t].turnsInToll == 0) != (shm->truckTurnsInToll[t] == 0)) {
+            mark_truck_dirty(t);
+        }
+
         trucks[t].id  = t;
         trucks[t].x   = shm->truckPositions[t][0];
         trucks[t].y   = shm->truckPositions[t][1];
 
         trucks[t].currentPackageCount = shm->truckPackageCount[t];
+        trucks[t].turnsInToll = shm->truckTurnsInToll[t];
 
-        for (int i = 0; i < TRUCK_MAX_CAP; i++) {
-            trucks[t].packageIds[i] = -1;
-        }
+        fleet.x[t] = trucks[t].x;
+        fleet.y[t] = trucks[t].y;
 
-        // Packages assigned to this truck but not yet picked up
-        trucks[t].assignedCount = 0;
-        for (int i = 0; i < TRUCK_MAX_CAP; i++) {
-            trucks[t].assignedPackageIds[i] = -1;
-        }
-        
-        printf("Truck %d: pos=(%d,%d), currentPackageCount=%d\n",
-               trucks[t].id,
-               trucks[t].x,
-               trucks[t].y,
-               trucks[t].currentPackageCount);
+        LOG_DEBUG(EV_TRUCK_STATE, t,
+                  trucks[t].x, trucks[t].y, trucks[t].currentPackageCount);
         }
     }
 
@@ -145,6 +702,530 @@ int manhattan(int x1, int y1, int x2, int y2) {
     return dx + dy;
 }
 
+// ---- Distance oracle ----
+// Travel times on the toll-weighted grid. Tolls are unknown up front and
+// are learned as trucks hit them (learn_tolls). Moving out of a cell whose
+// toll was just paid costs 1 + toll, so the time from u to v is the number
+// of moves plus the tolls of every cell strictly between them.
+//
+// Queries are answered from, in order of preference:
+//   - an exact single-source field for the destination, if cached;
+//   - a freshly computed field, once the destination has been asked for
+//     ORACLE_HOT_QUERIES times and the turn's fill budget allows it
+//     (fields live in a bounded LRU cache);
+//   - an ALT lower bound from the landmark fields, never below Manhattan.
+// oracle_next_move goes through the same admission. Without a field it
+// runs an A* search under the ALT bound, out of its own per-turn budget,
+// and past that steps greedily by toll plus ALT bound towards the target.
+
+#define ORACLE_LANDMARKS        8
+#define ORACLE_HOT_QUERIES      4
+#define ORACLE_MAX_FIELDS       256
+#define ORACLE_CACHE_BYTES      (64 << 20)
+#define ORACLE_LANDMARK_REFRESH 8    // rebuild landmarks after this many new tolls
+#define ORACLE_FILL_BUDGET      (256 << 10) // cells swept per turn for hot queries
+#define ORACLE_SEARCH_BUDGET    (64 << 10)  // cells expanded per turn by oracle_search_step
+
+typedef struct {
+    int dest;                // cell index, -1 if slot is free
+    int stale;               // 1 if a learned toll invalidated it
+    unsigned long lastUsed;  // LRU stamp
+    int *dist;               // dist[u] = travel time u -> dest
+} DistField;
+
+static int gridN;
+static int *knownToll;                 // N*N, 0 where no toll seen
+static int knownTollCount;
+static int maxKnownToll;
+static int tollsSinceLandmarks;
+
+// Known tolls by row and by column, for the bounding-box test.
+typedef struct {
+    int *at;                 // other coordinate of every toll on the line
+    int count, cap;
+} TollLine;
+static TollLine *tollRows;             // N, indexed by x
+static TollLine *tollCols;             // N, indexed by y
+
+static int landmarkCell[ORACLE_LANDMARKS];
+static int *landmarkDist[ORACLE_LANDMARKS];
+static int landmarksValid;
+
+static DistField *fields;
+static int fieldCapacity;
+static short *fieldSlotOf;             // N*N, slot index or -1
+static unsigned char *hotCount;        // N*N, saturating query counter
+static unsigned long oracleClock;
+static long fillBudget;
+static unsigned long turnStartClock;
+static int admitClosed;                // no slot left that is cold this turn
+
+// Set on zone planning threads. Their lookups must leave the shared cache
+// alone, so they use fresh fields as they are and otherwise the ALT bound.
+static __thread int oracleReadOnly;
+
+// A* scratch for oracle_search_step; searchStamp marks this search's cells.
+typedef struct {
+    int f, g, cell;
+} SearchEntry;
+static int *searchG;                   // N*N, cost from the start, leaving the cell
+static int *searchFrom;                // N*N, predecessor on the best path
+static unsigned *searchStamp;          // N*N
+static unsigned searchGen;
+static SearchEntry *searchHeap;        // 4*N*N + 1 entries
+static long searchBudget;
+
+// Dial's bucket queue, shared by every field computation.
+static int *ringHead;
+static int ringSize;
+static int *entryCell;
+static int *entryNext;
+
+static int cell_of(int x, int y) { return x * gridN + y; }
+
+void oracle_init(int N) {
+    gridN = N;
+    int cells = N * N;
+
+    knownToll = calloc(cells, sizeof(int));
+    fieldSlotOf = malloc(cells * sizeof(short));
+    hotCount = calloc(cells, 1);
+    tollRows = calloc(N, sizeof(TollLine));
+    tollCols = calloc(N, sizeof(TollLine));
+    searchG = malloc(cells * sizeof(int));
+    searchFrom = malloc(cells * sizeof(int));
+    searchStamp = calloc(cells, sizeof(unsigned));
+    searchHeap = malloc((4 * (size_t)cells + 1) * sizeof(SearchEntry));
+    entryCell = malloc(4 * cells * sizeof(int) + sizeof(int));
+    entryNext = malloc(4 * cells * sizeof(int) + sizeof(int));
+    for (int i = 0; i < cells; i++) fieldSlotOf[i] = -1;
+
+    fieldCapacity = ORACLE_CACHE_BYTES / (cells * (int)sizeof(int));
+    if (fieldCapacity > ORACLE_MAX_FIELDS) fieldCapacity = ORACLE_MAX_FIELDS;
+    if (fieldCapacity < 4) fieldCapacity = 4;
+    fields = calloc(fieldCapacity, sizeof(DistField));
+    for (int i = 0; i < fieldCapacity; i++) fields[i].dest = -1;
+
+    // Corners and edge midpoints spread the landmarks around the border,
+    // which is where ALT bounds are tightest on a grid.
+    int m = (N - 1) / 2, e = N - 1;
+    int lx[ORACLE_LANDMARKS] = {0, e, 0, e, m, m, 0, e};
+    int ly[ORACLE_LANDMARKS] = {0, 0, e, e, 0, e, m, m};
+    for (int i = 0; i < ORACLE_LANDMARKS; i++) {
+        landmarkCell[i] = cell_of(lx[i], ly[i]);
+        landmarkDist[i] = malloc(cells * sizeof(int));
+    }
+    landmarksValid = 0;
+}
+
+// Reverse Dijkstra from dest with integer weights in [1, 1 + maxKnownToll].
+static void oracle_fill_field(int dest, int *dist) {
+    int cells = gridN * gridN;
+    int ring = maxKnownToll + 2;
+    if (ring > ringSize) {
+        ringHead = realloc(ringHead, ring * sizeof(int));
+        ringSize = ring;
+    }
+    for (int b = 0; b < ring; b++) ringHead[b] = -1;
+    for (int i = 0; i < cells; i++) dist[i] = INT_MAX;
+
+    int used = 0, pending = 0;
+    dist[dest] = 0;
+    entryCell[used] = dest;
+    entryNext[used] = ringHead[0];
+    ringHead[0] = used++;
+    pending++;
+
+    for (int cur = 0; pending > 0; cur++) {
+        int b = cur % ring;
+        while (ringHead[b] != -1) {
+            int e = ringHead[b];
+            ringHead[b] = entryNext[e];
+            pending--;
+
+            int v = entryCell[e];
+            if (dist[v] != cur) continue;   // superseded entry
+
+            int w = cur + 1 + (v == dest ? 0 : knownToll[v]);
+            int vx = v / gridN, vy = v % gridN;
+            int nb[4] = {-1, -1, -1, -1};
+            if (vx > 0)         nb[0] = v - gridN;
+            if (vx < gridN - 1) nb[1] = v + gridN;
+            if (vy > 0)         nb[2] = v - 1;
+            if (vy < gridN - 1) nb[3] = v + 1;
+
+            for (int k = 0; k < 4; k++) {
+                int u = nb[k];
+                if (u < 0 || w >= dist[u]) continue;
+                dist[u] = w;
+                entryCell[used] = u;
+                entryNext[used] = ringHead[w % ring];
+                ringHead[w % ring] = used++;
+                pending++;
+            }
+        }
+    }
+}
+
+static void oracle_refresh_landmarks(void) {
+    for (int i = 0; i < ORACLE_LANDMARKS; i++) {
+        oracle_fill_field(landmarkCell[i], landmarkDist[i]);
+    }
+    landmarksValid = 1;
+    tollsSinceLandmarks = 0;
+}
+
+static int oracle_victim_slot(void) {
+    int slot = 0;
+    for (int i = 0; i < fieldCapacity; i++) {
+        if (fields[i].dest == -1) return i;
+        if (fields[i].lastUsed < fields[slot].lastUsed) slot = i;
+    }
+    return slot;
+}
+
+// Exact field for dest, computing it (and evicting the LRU slot) if needed.
+const int *oracle_field(int dest) {
+    int slot = fieldSlotOf[dest];
+
+    if (slot < 0) {
+        slot = oracle_victim_slot();
+        if (fields[slot].dest != -1) {
+            fieldSlotOf[fields[slot].dest] = -1;
+            hotCount[fields[slot].dest] = 0;   // must earn its way back in
+        } else {
+            fields[slot].dist = malloc(gridN * gridN * sizeof(int));
+        }
+        fields[slot].dest = dest;
+        fields[slot].stale = 1;
+        fieldSlotOf[dest] = (short)slot;
+    }
+
+    if (fields[slot].stale) {
+        fillBudget -= gridN * gridN;
+        oracle_fill_field(dest, fields[slot].dist);
+        fields[slot].stale = 0;
+    }
+    fields[slot].lastUsed = ++oracleClock;
+    return fields[slot].dist;
+}
+
+static void toll_line_add(TollLine *line, int at) {
+    if (line->count == line->cap) {
+        line->cap = line->cap ? 2 * line->cap : 4;
+        line->at = realloc(line->at, line->cap * sizeof(int));
+    }
+    line->at[line->count++] = at;
+}
+
+// 1 if a toll on lines [lo, hi] has its other coordinate in [olo, ohi],
+// skipping the endpoints (a1,b1) and (a2,b2) given in line-major order.
+static int toll_lines_hit(const TollLine *lines, int lo, int hi, int olo, int ohi,
+                          int a1, int b1, int a2, int b2) {
+    for (int a = lo; a <= hi; a++) {
+        for (int i = 0; i < lines[a].count; i++) {
+            int b = lines[a].at[i];
+            if (b < olo || b > ohi) continue;
+            if ((a == a1 && b == b1) || (a == a2 && b == b2)) continue;
+            return 1;
+        }
+    }
+    return 0;
+}
+
+// 1 if no known toll lies in the bounding box of the two cells (endpoints
+// excluded): then any monotone path is a fastest one. Walks the box along
+// its shorter side, so the cost is that side plus the tolls met on it.
+static int box_is_toll_free(int x1, int y1, int x2, int y2) {
+    if (knownTollCount == 0) return 1;
+
+    int lox = x1 < x2 ? x1 : x2, hix = x1 < x2 ? x2 : x1;
+    int loy = y1 < y2 ? y1 : y2, hiy = y1 < y2 ? y2 : y1;
+    if (hix - lox <= hiy - loy) {
+        return !toll_lines_hit(tollRows, lox, hix, loy, hiy, x1, y1, x2, y2);
+    }
+    return !toll_lines_hit(tollCols, loy, hiy, lox, hix, y1, x1, y2, x2);
+}
+
+// d(u,L) <= d(u,v) + toll(v) + d(v,L), never below Manhattan.
+static int oracle_alt_bound(int u, int v, int md) {
+    int best = md;
+    for (int i = 0; i < ORACLE_LANDMARKS; i++) {
+        int lb = landmarkDist[i][u] - landmarkDist[i][v] - knownToll[v];
+        if (lb > best) best = lb;
+    }
+    return best;
+}
+
+// Exact field towards v if one is cached, or once v is hot and the turn's
+// fill budget admits computing it; NULL otherwise.
+static const int *oracle_admitted_field(int v) {
+    int slot = fieldSlotOf[v];
+    if (slot >= 0 && !fields[slot].stale) {
+        if (!oracleReadOnly) fields[slot].lastUsed = ++oracleClock;
+        return fields[slot].dist;
+    }
+    if (oracleReadOnly) return NULL;
+
+    if (hotCount[v] < 255) hotCount[v]++;
+    if (hotCount[v] >= ORACLE_HOT_QUERIES && fillBudget > 0 && !admitClosed) {
+        // Never evict a field that has already served this turn: with more
+        // hot destinations than slots that would just thrash.
+        int victim = (slot >= 0) ? slot : oracle_victim_slot();
+        if (slot >= 0 || fields[victim].dest == -1 ||
+            fields[victim].lastUsed <= turnStartClock) {
+            return oracle_field(v);
+        }
+        admitClosed = 1;
+    }
+    return NULL;
+}
+
+// Heap order: smallest f first, ties to the deepest entry. Every monotone
+// path through toll-free cells has the same f, and preferring depth follows
+// one of them instead of expanding the whole box.
+static int search_before(const SearchEntry *a, const SearchEntry *b) {
+    return a->f < b->f || (a->f == b->f && a->g > b->g);
+}
+
+static void search_push(int *len, int f, int g, int cell) {
+    SearchEntry e = {f, g, cell};
+    int i = (*len)++;
+    while (i > 0) {
+        int parent = (i - 1) / 2;
+        if (!search_before(&e, &searchHeap[parent])) break;
+        searchHeap[i] = searchHeap[parent];
+        i = parent;
+    }
+    searchHeap[i] = e;
+}
+
+static SearchEntry search_pop(int *len) {
+    SearchEntry top = searchHeap[0];
+    SearchEntry last = searchHeap[--(*len)];
+    int i = 0;
+    while (1) {
+        int c = 2 * i + 1;
+        if (c >= *len) break;
+        if (c + 1 < *len && search_before(&searchHeap[c + 1], &searchHeap[c])) c++;
+        if (!search_before(&searchHeap[c], &last)) break;
+        searchHeap[i] = searchHeap[c];
+        i = c;
+    }
+    searchHeap[i] = last;
+    return top;
+}
+
+// First cell of a fastest known route from u to v, by A* under the ALT
+// bound (admissible, so the route is exact), or -1 once the turn's search
+// budget runs out. The cost of a cell includes leaving it: 1 per move plus
+// the toll of every cell after u, except v itself.
+static int oracle_search_step(int u, int v) {
+    if (++searchGen == 0) {
+        memset(searchStamp, 0, gridN * gridN * sizeof(unsigned));
+        searchGen = 1;
+    }
+    int len = 0;
+    searchStamp[u] = searchGen;
+    searchG[u] = 0;
+    searchFrom[u] = -1;
+    search_push(&len, 0, 0, u);
+
+    int reached = 0;
+    while (len > 0) {
+        SearchEntry e = search_pop(&len);
+        if (e.g != searchG[e.cell]) continue;   // superseded entry
+        if (e.cell == v) {
+            reached = 1;
+            break;
+        }
+        if (searchBudget-- <= 0) return -1;
+
+        int c = e.cell, cx = c / gridN, cy = c % gridN;
+        int nb[4] = {-1, -1, -1, -1};
+        if (cx > 0)         nb[0] = c - gridN;
+        if (cx < gridN - 1) nb[1] = c + gridN;
+        if (cy > 0)         nb[2] = c - 1;
+        if (cy < gridN - 1) nb[3] = c + 1;
+
+        for (int k = 0; k < 4; k++) {
+            int n = nb[k];
+            if (n < 0) continue;
+            int g = e.g + 1 + (n == v ? 0 : knownToll[n]);
+            if (searchStamp[n] == searchGen && searchG[n] <= g) continue;
+            searchStamp[n] = searchGen;
+            searchG[n] = g;
+            searchFrom[n] = c;
+            int md = manhattan(n / gridN, n % gridN, v / gridN, v % gridN);
+            search_push(&len, g + (n == v ? 0 : oracle_alt_bound(n, v, md)), g, n);
+        }
+    }
+    if (!reached) return -1;
+
+    int c = v;
+    while (searchFrom[c] != u) c = searchFrom[c];
+    return c;
+}
+
+static void oracle_refresh_landmarks_if_due(void) {
+    if (!landmarksValid || tollsSinceLandmarks >= ORACLE_LANDMARK_REFRESH) {
+        oracle_refresh_landmarks();
+    }
+}
+
+// Travel time from (x1,y1) to (x2,y2): exact when the destination is hot,
+// otherwise a lower bound.
+int travel_time(int x1, int y1, int x2, int y2) {
+    int md = manhattan(x1, y1, x2, y2);
+    if (md == 0 || knownTollCount == 0) return md;
+
+    int u = cell_of(x1, y1);
+    int v = cell_of(x2, y2);
+
+    const int *dist = oracle_admitted_field(v);
+    if (dist != NULL) return dist[u];
+    if (oracleReadOnly) return oracle_alt_bound(u, v, md);
+
+    oracle_refresh_landmarks_if_due();
+    return oracle_alt_bound(u, v, md);
+}
+
+// Make travel_time safe to call from several read-only threads at once.
+void oracle_freeze(void) {
+    if (knownTollCount > 0) oracle_refresh_landmarks_if_due();
+}
+
+// Record a toll seen at (x,y). Cached fields whose shortest-path tree runs
+// through that cell are marked stale; the rest stay exact. Landmark fields
+// only ever underestimate after a toll appears, so they stay valid bounds
+// and are rebuilt in batches.
+void oracle_learn_toll(int x, int y, int cost) {
+    int c = cell_of(x, y);
+    int old = knownToll[c];
+    if (cost <= old) return;
+
+    knownToll[c] = cost;
+    if (old == 0) {
+        toll_line_add(&tollRows[x], y);
+        toll_line_add(&tollCols[y], x);
+        knownTollCount++;
+    }
+    if (cost > maxKnownToll) maxKnownToll = cost;
+    tollsSinceLandmarks++;
+
+    int nb[4] = {-1, -1, -1, -1};
+    if (x > 0)         nb[0] = c - gridN;
+    if (x < gridN - 1) nb[1] = c + gridN;
+    if (y > 0)         nb[2] = c - 1;
+    if (y < gridN - 1) nb[3] = c + 1;
+
+    for (int i = 0; i < fieldCapacity; i++) {
+        DistField *f = &fields[i];
+        if (f->dest == -1 || f->stale || f->dest == c) continue;
+
+        int through = f->dist[c] + 1 + old;
+        for (int k = 0; k < 4; k++) {
+            if (nb[k] >= 0 && f->dist[nb[k]] == through) {
+                f->stale = 1;
+                break;
+            }
+        }
+    }
+}
+
+// Called once per turn before planning.
+void oracle_new_turn(void) {
+    fillBudget = ORACLE_FILL_BUDGET;
+    searchBudget = ORACLE_SEARCH_BUDGET;
+    turnStartClock = oracleClock;
+    admitClosed = 0;
+}
+
+// Next step from (x,y) towards (tx,ty) along a fastest known route: from
+// the field for (tx,ty) if the fill budget admits one, else from an A*
+// search. Once both budgets are spent, the step towards the target whose
+// next cell's toll plus ALT bound is smallest; that never moves away from
+// the target, so it arrives in Manhattan-distance moves.
+char oracle_next_move(int x, int y, int tx, int ty) {
+    if (x == tx && y == ty) return 's';
+
+    if (box_is_toll_free(x, y, tx, ty)) {
+        if (tx != x) return (tx > x) ? 'r' : 'l';
+        return (ty > y) ? 'd' : 'u';
+    }
+
+    int v = cell_of(tx, ty);
+    const int *dist = oracle_admitted_field(v);
+    if (dist == NULL && !oracleReadOnly) {
+        oracle_refresh_landmarks_if_due();
+        int n = oracle_search_step(cell_of(x, y), v);
+        if (n >= 0) {
+            int nx = n / gridN, ny = n % gridN;
+            if (nx != x) return (nx > x) ? 'r' : 'l';
+            return (ny > y) ? 'd' : 'u';
+        }
+    }
+    if (dist == NULL) {
+        char best = 's';
+        int bestCost = INT_MAX;
+        for (int k = 0; k < 2; k++) {
+            int nx = x, ny = y;
+            char move;
+            if (k == 0) {
+                if (tx == x) continue;
+                nx += (tx > x) ? 1 : -1;
+                move = (tx > x) ? 'r' : 'l';
+            } else {
+                if (ty == y) continue;
+                ny += (ty > y) ? 1 : -1;
+                move = (ty > y) ? 'd' : 'u';
+            }
+            int n = cell_of(nx, ny);
+            int cost = oracle_alt_bound(n, v, manhattan(nx, ny, tx, ty));
+            if (n != v) cost += knownToll[n];
+            if (cost < bestCost) {
+                bestCost = cost;
+                best = move;
+            }
+        }
+        return best;
+    }
+
+    const int dxs[4] = {1, -1, 0, 0};
+    const int dys[4] = {0, 0, 1, -1};
+    const char moves[4] = {'r', 'l', 'd', 'u'};
+
+    char best = 's';
+    int bestCost = INT_MAX;
+    for (int k = 0; k < 4; k++) {
+        int nx = x + dxs[k], ny = y + dys[k];
+        if (nx < 0 || nx >= gridN || ny < 0 || ny >= gridN) continue;
+
+        int n = cell_of(nx, ny);
+        int cost = dist[n];
+        if (cost == INT_MAX) continue;
+        if (nx != tx || ny != ty) cost += knownToll[n];
+        if (cost < bestCost) {
+            bestCost = cost;
+            best = moves[k];
+        }
+    }
+    return best;
+}
+
+// A truck whose toll counter jumped from 0 has just paid the toll of the
+// cell it stands on. Must run before readTruckInfo overwrites turnsInToll.
+void learn_tolls(MainSharedMemory *shm, int D, TruckInfo trucks[]) {
+    for (int t = 0; t < D; t++) {
+        int wait = shm->truckTurnsInToll[t];
+        if (wait > 0 && trucks[t].turnsInToll == 0) {
+            int x = shm->truckPositions[t][0], y = shm->truckPositions[t][1];
+            if (wait > knownToll[cell_of(x, y)]) mark_world_dirty();
+            oracle_learn_toll(x, y, wait);
+        }
+    }
+}
+
 double sqrt1(double x) {
     if (x < 0) {
         return -1;  
@@ -153,258 +1234,1517 @@ double sqrt1(double x) {
         return x;
     }
 
-    double guess = x;
-    double epsilon = 1e-7; 
-
-    while (1) {
-        double next = 0.5 * (guess + x / guess);
+    double guess = x;
+    double epsilon = 1e-7; 
+
+    while (1) {
+        double next = 0.5 * (guess + x / guess);
+
+        if ( (next - guess < epsilon && next - guess > -epsilon) )
+            return next;
+
+        guess = next;
+    }
+}
+
+
+void compute_truck_dropoff_centroid(const TruckInfo *t, double *cx, double *cy) {
+    double sumX = 0.0, sumY = 0.0;
+    int count = 0;
+
+    // onboard packages: use dropoffs
+    for (int i = 0; i < t->currentPackageCount; i++) {
+        int pid = t->packageIds[i];
+        if (pid < 0) continue;
+        PackageRequest *p = &allPackages[pid].pkg;
+        sumX += p->dropoff_x;
+        sumY += p->dropoff_y;
+        count++;
+    }
+
+    // assigned but not yet picked
+    for (int i = 0; i < t->assignedCount; i++) {
+        int pid = t->assignedPackageIds[i];
+        if (pid < 0) continue;
+        PackageRequest *p = &allPackages[pid].pkg;
+        sumX += p->dropoff_x;
+        sumY += p->dropoff_y;
+        count++;
+    }
+
+    if (count == 0) {
+        // no targets yet: use current truck position
+        *cx = (double)t->x;
+        *cy = (double)t->y;
+    } else {
+        *cx = sumX / count;
+        *cy = sumY / count;
+    }
+}
+
+// Compute cosine similarity between two 2D vectors.
+double cosine_similarity(double ax, double ay, double bx, double by) {
+    double dot = ax * bx + ay * by;
+    double na = sqrt1(ax * ax + ay * ay);
+    double nb = sqrt1(bx * bx + by * by);
+    if (na == 0.0 || nb == 0.0) return 1.0;
+    return dot / (na * nb);
+}
+
+// Compute approximate route length for a truck:
+int compute_truck_route_length(const TruckInfo *t, int *lastX, int *lastY) {
+    int cx = t->x;
+    int cy = t->y;
+    int total = 0;
+
+    // onboard: go to each dropoff
+    for (int i = 0; i < t->currentPackageCount; i++) {
+        int pid = t->packageIds[i];
+        if (pid < 0) continue;
+        PackageRequest *p = &allPackages[pid].pkg;
+        total += travel_time(cx, cy, p->dropoff_x, p->dropoff_y);
+        cx = p->dropoff_x;
+        cy = p->dropoff_y;
+    }
+
+    // assigned: pickup then dropoff
+    for (int i = 0; i < t->assignedCount; i++) {
+        int pid = t->assignedPackageIds[i];
+        if (pid < 0) continue;
+        PackageRequest *p = &allPackages[pid].pkg;
+
+        total += travel_time(cx, cy, p->pickup_x, p->pickup_y);
+        cx = p->pickup_x;
+        cy = p->pickup_y;
+
+        total += travel_time(cx, cy, p->dropoff_x, p->dropoff_y);
+        cx = p->dropoff_x;
+        cy = p->dropoff_y;
+    }
+
+    if (lastX) *lastX = cx;
+    if (lastY) *lastY = cy;
+    return total;
+}
+
+// Refresh the fleet's route-end data for truck t. Called for every truck
+// by triagePackages and again whenever assignPackagesToTrucks hands out
+// work. busy = turns until t could start on something new: toll wait,
+// remaining route, plus one stationary turn per pickup/dropoff ahead.
+void refresh_truck_busy(const TruckInfo *t) {
+    int endX, endY;
+    int len = compute_truck_route_length(t, &endX, &endY);
+
+    fleet.endX[t->id] = endX;
+    fleet.endY[t->id] = endY;
+    fleet.load[t->id] = t->currentPackageCount + t->assignedCount;
+    fleet.busy[t->id] = t->turnsInToll + len
+                      + t->currentPackageCount + 2 * t->assignedCount;
+}
+
+static int triage_cmp(const void *a, const void *b) {
+    const PackageInfo *pa = &allPackages[*(const int *)a];
+    const PackageInfo *pb = &allPackages[*(const int *)b];
+    if (pa->triage != pb->triage) return pa->triage - pb->triage;
+    if (pa->triage == TRIAGE_OVERDUE && pa->pkg.arrival_turn != pb->pkg.arrival_turn) {
+        return pa->pkg.arrival_turn - pb->pkg.arrival_turn;
+    }
+    if (pa->slack != pb->slack) return pa->slack - pb->slack;
+    return pa->pkg.packageId - pb->pkg.packageId;
+}
+
+// Route-end signature of every truck at the last triage pass.
+static int sigEndX[MAX_TRUCKS], sigEndY[MAX_TRUCKS];
+static int sigAvail[MAX_TRUCKS], sigCapOk[MAX_TRUCKS];
+static int sigValid;
+
+// Best ETA for p over every truck with room; the winner goes to etaTruck.
+static void triage_full_scan(PackageInfo *info, int D, int turn) {
+    const int INF = 1000000000;
+    PackageRequest *p = &info->pkg;
+
+    // Manhattan bounds for the whole fleet first; the oracle is only
+    // asked about trucks whose bound can still beat the best ETA.
+    static FleetScores sc;
+    score_fleet(p->pickup_x, p->pickup_y, D, TRUCK_MAX_CAP, &sc);
+    int tail = turn + travel_time(p->pickup_x, p->pickup_y, p->dropoff_x, p->dropoff_y) + 1;
+
+    info->bestEta = INF;
+    info->etaTruck = -1;
+    for (int t = 0; t < D; t++) {
+        if (!fleet_cap_ok(&sc, t)) continue;
+        if (tail + fleet.busy[t] + sc.endToPickup[t] >= info->bestEta) continue;
+
+        int eta = tail + fleet.busy[t]
+                + travel_time(fleet.endX[t], fleet.endY[t], p->pickup_x, p->pickup_y);
+        if (eta < info->bestEta) {
+            info->bestEta = eta;
+            info->etaTruck = t;
+        }
+    }
+}
+
+// ---- Planner parameters ----
+// The assignment heuristics' knobs. The defaults are the values hand-tuned
+// on the sample testcases; SOLUTION_PARAMS=path reads "name value" lines
+// (# starts a comment) over them, as written by tune.py for a workload class.
+
+typedef struct PlannerParams {
+    int batchSize;           // unassigned packages placed per turn
+    int maxCapacity;         // soft planned load per truck
+    int nearRadius;          // strict pickup radius of a lightly loaded truck
+    int loadedRadius;        // ... of a truck carrying more than loadedAbove
+    int loadedAbove;
+    double alignCosine;      // route direction similarity that earns alignedLimit
+    int alignedLimit;        // strict insertion cost, direction aligned
+    int otherLimit;          // strict insertion cost otherwise
+} PlannerParams;
+
+static PlannerParams params = {10, 5, 4, 3, 2, 0.7, 4, 2};
+
+static const struct {
+    const char *name;
+    int isInt;
+    size_t offset;
+} paramFields[] = {
+    {"batch_size",     1, offsetof(PlannerParams, batchSize)},
+    {"max_capacity",   1, offsetof(PlannerParams, maxCapacity)},
+    {"near_radius",    1, offsetof(PlannerParams, nearRadius)},
+    {"loaded_radius",  1, offsetof(PlannerParams, loadedRadius)},
+    {"loaded_above",   1, offsetof(PlannerParams, loadedAbove)},
+    {"align_cosine",   0, offsetof(PlannerParams, alignCosine)},
+    {"aligned_limit",  1, offsetof(PlannerParams, alignedLimit)},
+    {"other_limit",    1, offsetof(PlannerParams, otherLimit)},
+};
+
+void params_load(void) {
+    const char *path = getenv("SOLUTION_PARAMS");
+    if (path == NULL) return;
+    FILE *f = fopen(path, "r");
+    if (!f) {
+        fprintf(stderr, "SOLUTION_PARAMS: cannot open %s, using defaults\n", path);
+        return;
+    }
+
+    char line[256], name[64];
+    double value;
+    while (fgets(line, sizeof(line), f)) {
+        char *hash = strchr(line, '#');
+        if (hash) *hash = '\0';
+        if (sscanf(line, "%63s %lf", name, &value) != 2) continue;
+
+        size_t k = 0, n = sizeof(paramFields) / sizeof(paramFields[0]);
+        while (k < n && strcmp(paramFields[k].name, name) != 0) k++;
+        if (k == n) {
+            fprintf(stderr, "SOLUTION_PARAMS: unknown parameter %s\n", name);
+            continue;
+        }
+        char *field = (char *)&params + paramFields[k].offset;
+        if (paramFields[k].isInt) *(int *)field = (int)value;
+        else *(double *)field = value;
+    }
+    fclose(f);
+
+    if (params.batchSize < 1) params.batchSize = 1;
+    if (params.maxCapacity < 1) params.maxCapacity = 1;
+    if (params.maxCapacity > TRUCK_MAX_CAP) params.maxCapacity = TRUCK_MAX_CAP;
+}
+
+// ---- Zones ----
+// On big grids one global pass over every truck for every package is both
+// slow and mostly wasted: far trucks never win. With SOLUTION_ZONES=K the
+// grid is cut into up to K rectangles and triage scans and assignment run
+// per zone, one thread each, against only the trucks whose route ends in
+// that zone. The cuts are recursive bisections, each placed so both sides
+// get a share of trucks and waiting pickups in proportion to the zones
+// they will hold; they are redone every ZONE_REBUILD turns. A truck belongs
+// to the zone its route ends in, so it migrates as its route crosses a
+// boundary. Packages their zone cannot place go through the boundary
+// exchange: the ordinary whole-fleet pass, run after the zone threads.
+//
+// Zone threads only read shared state, apart from their own packages and
+// trucks; travel_time runs read-only there (oracleReadOnly).
+
+#define MAX_ZONES      16
+#define ZONE_REBUILD   25     // turns between re-cutting the grid
+#define ZONE_AUTO_MIN_N 200   // SOLUTION_ZONES=auto turns zones on from this grid size
+
+static int zoneCount;                  // 0 when zones are off
+static int zoneTarget;                 // zones asked for
+static int zoneX0[MAX_ZONES], zoneX1[MAX_ZONES];
+static int zoneY0[MAX_ZONES], zoneY1[MAX_ZONES];
+static int zoneBuiltTurn;
+static int zoneOfTruck[MAX_TRUCKS];    // -1 before the first assignment
+static int zoneTrucks[MAX_ZONES][MAX_TRUCKS];
+static int zoneTruckCount[MAX_ZONES];
+static int zonePkgs[MAX_ZONES][MAX_TOTAL_PACKAGES];
+static int zonePkgCount[MAX_ZONES];
+static double *zoneHist;               // N, weights along the cut axis
+
+typedef struct ZonePoint {
+    int x, y;
+    double w;
+} ZonePoint;
+
+static ZonePoint zonePoints[MAX_TRUCKS + MAX_TOTAL_PACKAGES];
+static int zonePointCount;
+
+void zones_init(int N) {
+    const char *env = getenv("SOLUTION_ZONES");
+    if (env == NULL) return;
+
+    if (strcmp(env, "auto") == 0) {
+        long cpus = sysconf(_SC_NPROCESSORS_ONLN);
+        zoneTarget = (N >= ZONE_AUTO_MIN_N && cpus > 1) ? (int)cpus : 0;
+    } else {
+        zoneTarget = atoi(env);
+    }
+    if (zoneTarget > MAX_ZONES) zoneTarget = MAX_ZONES;
+    if (zoneTarget < 2) {
+        zoneTarget = 0;
+        return;
+    }
+
+    zoneHist = malloc(N * sizeof(double));
+    zoneBuiltTurn = INT_MIN / 2;
+    for (int t = 0; t < MAX_TRUCKS; t++) zoneOfTruck[t] = -1;
+}
+
+// Cut [x0,x1]x[y0,y1] into k zones, splitting the longer side where the
+// weight to the left is k1/k of the region's.
+static void zone_split(int x0, int x1, int y0, int y1, int k) {
+    int alongX = (x1 - x0) >= (y1 - y0);
+    int lo = alongX ? x0 : y0, hi = alongX ? x1 : y1;
+
+    if (k == 1 || lo == hi) {
+        zoneX0[zoneCount] = x0;
+        zoneX1[zoneCount] = x1;
+        zoneY0[zoneCount] = y0;
+        zoneY1[zoneCount] = y1;
+        zoneCount++;
+        return;
+    }
+
+    double total = 0.0;
+    for (int c = lo; c <= hi; c++) zoneHist[c] = 0.0;
+    for (int i = 0; i < zonePointCount; i++) {
+        ZonePoint *pt = &zonePoints[i];
+        if (pt->x < x0 || pt->x > x1 || pt->y < y0 || pt->y > y1) continue;
+        zoneHist[alongX ? pt->x : pt->y] += pt->w;
+        total += pt->w;
+    }
+
+    int k1 = k / 2;
+    int cut = lo + (hi - lo + 1) * k1 / k - 1;   // nothing to balance: even split
+    if (total > 0.0) {
+        double want = total * k1 / k, sum = 0.0;
+        for (cut = lo; cut < hi - 1; cut++) {
+            sum += zoneHist[cut];
+            if (sum >= want) break;
+        }
+    }
+    if (cut < lo) cut = lo;
+    if (cut > hi - 1) cut = hi - 1;
+
+    if (alongX) {
+        zone_split(x0, cut, y0, y1, k1);
+        zone_split(cut + 1, x1, y0, y1, k - k1);
+    } else {
+        zone_split(x0, x1, y0, cut, k1);
+        zone_split(x0, x1, cut + 1, y1, k - k1);
+    }
+}
+
+// Trucks (at their route ends) and waiting pickups count equally in total.
+static void zones_rebuild(int D) {
+    zonePointCount = 0;
+    for (int t = 0; t < D; t++) {
+        zonePoints[zonePointCount++] = (ZonePoint){fleet.endX[t], fleet.endY[t], 1.0};
+    }
+    double pkgWeight = unassignedCount > 0 ? (double)D / unassignedCount : 0.0;
+    for (int i = 0; i < unassignedCount; i++) {
+        PackageRequest *p = &allPackages[unassignedIds[i]].pkg;
+        zonePoints[zonePointCount++] = (ZonePoint){p->pickup_x, p->pickup_y, pkgWeight};
+    }
+
+    zoneCount = 0;
+    zone_split(0, gridN - 1, 0, gridN - 1, zoneTarget);
+}
+
+static int zone_of(int x, int y) {
+    for (int z = 0; z < zoneCount; z++) {
+        if (x >= zoneX0[z] && x <= zoneX1[z] && y >= zoneY0[z] && y <= zoneY1[z]) return z;
+    }
+    return 0;
+}
+
+// Re-cut if due and sort the trucks into zones. Needs fresh route ends
+// (refresh_truck_busy), so it runs at the start of triage.
+void zones_begin_turn(int D, int turn) {
+    if (zoneTarget == 0) return;
+
+    if (turn - zoneBuiltTurn >= ZONE_REBUILD) {
+        zones_rebuild(D);
+        zoneBuiltTurn = turn;
+    }
+
+    for (int z = 0; z < zoneCount; z++) zoneTruckCount[z] = 0;
+    for (int t = 0; t < D; t++) {
+        int z = zone_of(fleet.endX[t], fleet.endY[t]);
+        if (zoneOfTruck[t] >= 0 && zoneOfTruck[t] != z) PROF_COUNT(CTR_ZONE_MIGRATIONS, 1);
+        zoneOfTruck[t] = z;
+        zoneTrucks[z][zoneTruckCount[z]++] = t;
+    }
+}
+
+typedef struct ZoneJob {
+    void (*run)(struct ZoneJob *job);
+    int zone;
+    int turn;
+    int capLimit;
+    TruckInfo *trucks;
+    int scored;          // pairs looked at, added to the profile afterwards
+} ZoneJob;
+
+static void *zone_thread(void *arg) {
+    ZoneJob *job = arg;
+    oracleReadOnly = 1;
+    job->run(job);
+    oracleReadOnly = 0;
+    return NULL;
+}
+
+// One thread per zone with packages; the caller's thread takes zone 0.
+static void zones_run(ZoneJob jobs[]) {
+    pthread_t threads[MAX_ZONES];
+    int started[MAX_ZONES];
+
+    oracle_freeze();
+    for (int z = 1; z < zoneCount; z++) {
+        started[z] = zonePkgCount[z] > 0 &&
+                     pthread_create(&threads[z], NULL, zone_thread, &jobs[z]) == 0;
+    }
+    if (zonePkgCount[0] > 0) zone_thread(&jobs[0]);
+    for (int z = 1; z < zoneCount; z++) {
+        if (started[z]) pthread_join(threads[z], NULL);
+        else if (zonePkgCount[z] > 0) zone_thread(&jobs[z]);
+    }
+}
+
+// triage_full_scan against the zone's trucks only.
+static void triage_zone_scan(ZoneJob *job) {
+    const int INF = 1000000000;
+    int z = job->zone;
+
+    for (int i = 0; i < zonePkgCount[z]; i++) {
+        PackageInfo *info = &allPackages[zonePkgs[z][i]];
+        PackageRequest *p = &info->pkg;
+        int tail = job->turn + travel_time(p->pickup_x, p->pickup_y, p->dropoff_x, p->dropoff_y) + 1;
+
+        info->bestEta = INF;
+        info->etaTruck = -1;
+        for (int k = 0; k < zoneTruckCount[z]; k++) {
+            int t = zoneTrucks[z][k];
+            if (fleet.load[t] >= TRUCK_MAX_CAP) continue;
+            if (tail + fleet.busy[t] + manhattan(fleet.endX[t], fleet.endY[t], p->pickup_x, p->pickup_y)
+                >= info->bestEta) continue;
+
+            int eta = tail + fleet.busy[t]
+                    + travel_time(fleet.endX[t], fleet.endY[t], p->pickup_x, p->pickup_y);
+            if (eta < info->bestEta) {
+                info->bestEta = eta;
+                info->etaTruck = t;
+            }
+        }
+    }
+}
+
+// Zone half of triagePackages: the packages that need a fresh scan are
+// scanned in their pickup's zone; those no zone truck can take are scanned
+// against the whole fleet.
+static void zones_triage(int D, int full, const unsigned char changed[], int turn) {
+    for (int z = 0; z < zoneCount; z++) zonePkgCount[z] = 0;
+    for (int i = 0; i < unassignedCount; i++) {
+        PackageInfo *info = &allPackages[unassignedIds[i]];
+        if (full || info->etaTruck < 0 || changed[info->etaTruck]) {
+            int z = zone_of(info->pkg.pickup_x, info->pkg.pickup_y);
+            zonePkgs[z][zonePkgCount[z]++] = unassignedIds[i];
+            PROF_COUNT(CTR_TRIAGE_FULL, 1);
+        } else {
+            PROF_COUNT(CTR_TRIAGE_KEPT, 1);
+        }
+    }
+
+    ZoneJob jobs[MAX_ZONES];
+    for (int z = 0; z < zoneCount; z++) {
+        jobs[z] = (ZoneJob){triage_zone_scan, z, turn, TRUCK_MAX_CAP, NULL, 0};
+    }
+    zones_run(jobs);
+
+    for (int z = 0; z < zoneCount; z++) {
+        for (int i = 0; i < zonePkgCount[z]; i++) {
+            PackageInfo *info = &allPackages[zonePkgs[z][i]];
+            if (info->etaTruck >= 0) continue;
+            triage_full_scan(info, D, turn);
+            PROF_COUNT(CTR_ZONE_EXCHANGES, 1);
+        }
+    }
+}
+
+// Classify every unassigned package by its slack against the best ETA any
+// truck can offer, then reorder the queue: at-risk first (least slack
+// first), then the rest by deadline, with unsaveable packages at the back.
+// An unsaveable package left waiting over BACKGROUND_MAX_WAIT turns is
+// overdue: it goes right after the at-risk ones, oldest first, and any
+// truck may take it, so it cannot starve behind a steady stream of new work.
+// The ETA through truck t is the turn it would drop p if p were appended to
+// its route; pickup and dropoff each cost a stationary turn, and the
+// dropoff turn must be <= expiry_turn for p to count as delivered in time.
+//
+// A truck following its route keeps the same end cell and the same
+// turn + busy, so the ETAs it offers do not change. Only trucks whose
+// signature changed are looked at again. One that merely got later at the
+// same end cell can only hurt the packages that were counting on it; one
+// whose end moved or got earlier is offered to every package.
+void triagePackages(TruckInfo trucks[], int D, int turn) {
+    const int INF = 1000000000;
+
+    static unsigned char changed[MAX_TRUCKS];
+    int improved[MAX_TRUCKS], improvedCount = 0;
+    int full = worldDirty || !sigValid;
+
+    for (int t = 0; t < D; t++) {
+        refresh_truck_busy(&trucks[t]);
+
+        int avail = turn + fleet.busy[t];
+        int capOk = fleet.load[t] < TRUCK_MAX_CAP;
+        int sameEnd = fleet.endX[t] == sigEndX[t] && fleet.endY[t] == sigEndY[t];
+
+        changed[t] = !(sameEnd && avail == sigAvail[t] && capOk == sigCapOk[t]);
+        if (changed[t] && !(sameEnd && avail >= sigAvail[t] && capOk <= sigCapOk[t])) {
+            improved[improvedCount++] = t;
+        }
+
+        sigEndX[t] = fleet.endX[t];
+        sigEndY[t] = fleet.endY[t];
+        sigAvail[t] = avail;
+        sigCapOk[t] = capOk;
+    }
+    sigValid = 1;
+
+    zones_begin_turn(D, turn);
+    if (zoneCount > 0) zones_triage(D, full, changed, turn);
+
+    for (int i = 0; i < unassignedCount; i++) {
+        PackageInfo *info = &allPackages[unassignedIds[i]];
+        PackageRequest *p = &info->pkg;
+
+        if (zoneCount > 0) {
+            // scanned by zones_triage
+        } else if (full || info->etaTruck < 0 || changed[info->etaTruck]) {
+            triage_full_scan(info, D, turn);
+            PROF_COUNT(CTR_TRIAGE_FULL, 1);
+        } else {
+            PROF_COUNT(CTR_TRIAGE_KEPT, 1);
+        }
+        if (!full && improvedCount > 0) {
+            int tail = turn + travel_time(p->pickup_x, p->pickup_y, p->dropoff_x, p->dropoff_y) + 1;
+            for (int k = 0; k < improvedCount; k++) {
+                int t = improved[k];
+                if (fleet.load[t] >= TRUCK_MAX_CAP) continue;
+                int eta = tail + fleet.busy[t]
+                        + travel_time(fleet.endX[t], fleet.endY[t], p->pickup_x, p->pickup_y);
+                if (eta < info->bestEta) {
+                    info->bestEta = eta;
+                    info->etaTruck = t;
+                }
+            }
+        }
+
+        info->slack = (info->bestEta == INF) ? -INF : p->expiry_turn - info->bestEta;
+
+        if (info->slack < 0 && turn - p->arrival_turn > BACKGROUND_MAX_WAIT) {
+            info->triage = TRIAGE_OVERDUE;
+        } else if (info->slack < 0) {
+            info->triage = TRIAGE_UNSAVEABLE;
+        } else if (info->slack <= AT_RISK_SLACK) {
+            info->triage = TRIAGE_AT_RISK;
+        } else {
+            info->triage = TRIAGE_NORMAL;
+        }
+    }
+
+    qsort(unassignedIds, unassignedCount, sizeof(int), triage_cmp);
+}
+
+
+// ---- Relay handoffs ----
+// A long delivery can be split into legs: the first truck drops the package
+// at a transfer cell on the way (the helper puts it back to waiting there)
+// and a truck better placed for the rest picks it up on a later turn. While
+// a leg is in progress pkg.dropoff_* holds the transfer cell and the real
+// destination is parked in finalX/finalY, so the rest of the planner only
+// ever sees "the current leg".
+
+#define RELAY_MIN_LEG     12   // legs shorter than this are never split
+#define RELAY_MIN_SLACK   (AT_RISK_SLACK + 6) // handoff costs a drop and a pickup turn
+#define RELAY_MAX_SPLITS  2
+#define RELAY_WAIT_SLACK  4    // how long the package may sit at the transfer cell
+#define RELAY_MAX_LOAD    4    // only lightly loaded trucks take over a leg
+
+// Turns before some truck other than `except` could be standing on (x,y)
+// ready for the next leg; that truck is returned through *who.
+static int relay_ready_time(int D, int x, int y, int except, int *who) {
+    int best = INT_MAX;
+    *who = -1;
+    for (int t = 0; t < D; t++) {
+        if (t == except || fleet.load[t] >= RELAY_MAX_LOAD) continue;
+        int eta = fleet.busy[t] + manhattan(fleet.endX[t], fleet.endY[t], x, y);
+        if (eta < best) {
+            best = eta;
+            *who = t;
+        }
+    }
+    return best;
+}
+
+// Decide whether the package's next leg should end at a transfer cell.
+// Candidates lie on the straight line from pickup to dropoff, so the split
+// adds no distance; one is taken only if another truck can be there about
+// when the package arrives.
+void maybe_plan_relay(PackageInfo *info, int D, int N) {
+    PackageRequest *p = &info->pkg;
+    int leg = manhattan(p->pickup_x, p->pickup_y, p->dropoff_x, p->dropoff_y);
+    int minLeg = N / 3 > RELAY_MIN_LEG ? N / 3 : RELAY_MIN_LEG;
+
+    if (info->relayLeg || info->relays >= RELAY_MAX_SPLITS) return;
+    if (leg < minLeg || info->triage != TRIAGE_NORMAL || info->slack < RELAY_MIN_SLACK) return;
+
+    const int fractions[3] = {2, 3, 4};   // 1/2, 1/3, 1/4 of the way from the dropoff
+    int bestX = -1, bestY = -1, bestWait = INT_MAX;
+
+    for (int k = 0; k < 3; k++) {
+        int x = p->dropoff_x + (p->pickup_x - p->dropoff_x) / fractions[k];
+        int y = p->dropoff_y + (p->pickup_y - p->dropoff_y) / fractions[k];
+        if (knownToll[cell_of(x, y)] > 0) continue;
+
+        int who;
+        int arrive = manhattan(p->pickup_x, p->pickup_y, x, y) + 1;
+        int wait = relay_ready_time(D, x, y, -1, &who) - arrive;
+        if (wait < bestWait) {
+            bestWait = wait;
+            bestX = x;
+            bestY = y;
+        }
+    }
+
+    if (bestX < 0 || bestWait > RELAY_WAIT_SLACK) return;
+
+    info->finalX = p->dropoff_x;
+    info->finalY = p->dropoff_y;
+    p->dropoff_x = bestX;
+    p->dropoff_y = bestY;
+    info->relayLeg = 1;
+    info->relays++;
+}
+
+// The package was just dropped at its transfer cell by truck `from`: it now
+// waits there for the next leg. It goes straight to the best-placed other
+// truck rather than to the back of the queue, and cannot be picked up
+// again this turn.
+void finish_relay_leg(PackageInfo *info, TruckInfo trucks[], int D, int from, int turn) {
+    PackageRequest *p = &info->pkg;
+    p->pickup_x = p->dropoff_x;
+    p->pickup_y = p->dropoff_y;
+    p->dropoff_x = info->finalX;
+    p->dropoff_y = info->finalY;
+    info->relayLeg = 0;
+    info->droppedTurn = turn;
+    info->assignedToTruck = -1;
+    LOG_INFO(EV_RELAY, from, p->packageId, p->pickup_x, p->pickup_y);
+
+    int t;
+    relay_ready_time(D, p->pickup_x, p->pickup_y, from, &t);
+    if (t >= 0 && trucks[t].assignedCount < TRUCK_MAX_CAP) {
+        trucks[t].assignedPackageIds[trucks[t].assignedCount++] = p->packageId;
+        info->assignedToTruck = t;
+        refresh_truck_busy(&trucks[t]);
+        mark_truck_dirty(t);
+    } else {
+        mark_package_dirty(info);
+        unassignedIds[unassignedCount++] = p->packageId;
+    }
+}
+
+// The helper's packageLocations is authoritative for where a handed-off
+// package waits; pick it up from there.
+void sync_relay_locations(MainSharedMemory *shm) {
+    for (int i = 0; i < unassignedCount; i++) {
+        PackageInfo *info = &allPackages[unassignedIds[i]];
+        if (info->relays == 0) continue;
+
+        int id = info->pkg.packageId;
+        int x = shm->packageLocations[id][0], y = shm->packageLocations[id][1];
+        if (x >= 0 && (x != info->pkg.pickup_x || y != info->pkg.pickup_y)) {
+            info->pkg.pickup_x = x;
+            info->pkg.pickup_y = y;
+            mark_package_dirty(info);
+        }
+    }
+}
+
+
+// Best truck among cand[0..n) for the package: a strict fit if there is
+// one, else for an at-risk package the earliest delivery, else the nearest
+// truck (*usedRelaxed set). -1 if no candidate has room. sc must hold the
+// Manhattan bounds of the candidates; *scored counts the pairs looked at.
+static int choose_truck(const PackageInfo *info, TruckInfo trucks[], const int cand[], int n,
+                        const FleetScores *sc, int turn, int *usedRelaxed, int *scored) {
+    const int INF = 1000000000;
+    const PackageRequest *p = &info->pkg;
+
+    int bestTruckStrict = -1;
+    int bestCostStrict = INF;
+    int bestLoadStrict = INF;
+
+    int bestTruckRelax = -1;
+    int bestDistRelax = INF;
+    int bestLoadRelax = INF;
+
+    int bestTruckEta = -1;
+    int bestEta = INF;
+
+    // Unsaveable packages still have to be delivered, but only by
+    // trucks with nothing better to do.
+    int background = (info->triage == TRIAGE_UNSAVEABLE);
+
+    int leg = travel_time(p->pickup_x, p->pickup_y, p->dropoff_x, p->dropoff_y);
+    int legLB = manhattan(p->pickup_x, p->pickup_y, p->dropoff_x, p->dropoff_y);
+    int maxLimit = params.alignedLimit > params.otherLimit ? params.alignedLimit : params.otherLimit;
+
+    for (int k = 0; k < n; k++) {
+        int t = cand[k];
+        TruckInfo *truck = &trucks[t];
+
+        // Capacity check (onboard + already assigned)
+        if (!fleet_cap_ok(sc, t)) {
+            continue;
+        }
+        (*scored)++;
+        int plannedLoad = fleet.load[t];
+        if (background && (plannedLoad > 0 || truck->turnsInToll > 0)) {
+            continue;
+        }
+
+        if (turn + fleet.busy[t] + sc->endToPickup[t] + leg + 1 < bestEta) {
+            int eta = turn + fleet.busy[t] + leg + 1
+                    + travel_time(fleet.endX[t], fleet.endY[t], p->pickup_x, p->pickup_y);
+            if (eta < bestEta) {
+                bestEta = eta;
+                bestTruckEta = t;
+            }
+        }
+
+        int max_dist = (truck->currentPackageCount > params.loadedAbove) ? params.loadedRadius : params.nearRadius;
+        if (sc->toPickup[t] > bestDistRelax && sc->toPickup[t] > max_dist) {
+            continue;   // can neither win the relaxed pick nor be strict
+        }
+
+        // Distance to pickup
+        int dist_to_pickup = travel_time(truck->x, truck->y, p->pickup_x, p->pickup_y);
+
+        if (dist_to_pickup < bestDistRelax ||
+            (dist_to_pickup == bestDistRelax && plannedLoad < bestLoadRelax) ||
+            (dist_to_pickup == bestDistRelax && plannedLoad == bestLoadRelax && t < bestTruckRelax))
+        {
+            bestDistRelax = dist_to_pickup;
+            bestLoadRelax = plannedLoad;
+            bestTruckRelax = t;
+        }
+
+        if (dist_to_pickup > max_dist || sc->endToPickup[t] + legLB > maxLimit) {
+            continue;
+        }
+
+        // Direction similarity
+        double cx, cy;
+        compute_truck_dropoff_centroid(truck, &cx, &cy);
+
+        double truck_vec_x = cx - truck->x;
+        double truck_vec_y = cy - truck->y;
+
+        double pkg_vec_x = (double)p->dropoff_x - (double)p->pickup_x;
+        double pkg_vec_y = (double)p->dropoff_y - (double)p->pickup_y;
+
+        double sim = cosine_similarity(truck_vec_x, truck_vec_y,
+                                       pkg_vec_x, pkg_vec_y);
+
+        // Route insertion cost: appending pickup+dropoff at end
+        int extra = travel_time(fleet.endX[t], fleet.endY[t], p->pickup_x, p->pickup_y)
+                    + leg;
+        int insertion_cost = extra;
+
+        int limit = (sim > params.alignCosine) ? params.alignedLimit : params.otherLimit;
+
+        // STRICT candidate: must satisfy insertion_cost <= limit
+        if (insertion_cost <= limit) {
+            if (insertion_cost < bestCostStrict ||
+                (insertion_cost == bestCostStrict && plannedLoad < bestLoadStrict) ||
+                (insertion_cost == bestCostStrict && plannedLoad == bestLoadStrict && t < bestTruckStrict))
+            {
+                bestCostStrict = insertion_cost;
+                bestLoadStrict = plannedLoad;
+                bestTruckStrict = t;
+            }
+        }
+    }
+
+    *usedRelaxed = 0;
+    if (bestTruckStrict != -1) {
+        return bestTruckStrict;
+    } else if (info->triage == TRIAGE_AT_RISK && bestTruckEta != -1) {
+        // Nearest-to-pickup ignores queueing; an at-risk package goes
+        // to whichever truck can actually deliver it soonest.
+        return bestTruckEta;
+    } else if (bestTruckRelax != -1) {
+        *usedRelaxed = 1;
+        return bestTruckRelax;
+    }
+    return -1;
+}
+
+// Append the package to the truck's assigned list; 0 if the list is full.
+static int give_to_truck(PackageInfo *info, TruckInfo *truck) {
+    int idx = truck->assignedCount;
+    if (idx >= TRUCK_MAX_CAP) return 0;
+
+    truck->assignedPackageIds[idx] = info->pkg.packageId;
+    truck->assignedCount++;
+    info->assignedToTruck = truck->id;
+    refresh_truck_busy(truck);
+    return 1;
+}
+
+// Place one package against the whole fleet, or put it back in the queue.
+static void assign_one(TruckInfo trucks[], int D, int turn, int pkgId, int capLimit) {
+    PackageInfo *info = &allPackages[pkgId];
+    PackageRequest *p = &info->pkg;
+
+    maybe_plan_relay(info, D, gridN);
+
+    // Manhattan bounds and capacity mask for every truck at once. Exact
+    // travel times are only looked up where the bound could still win.
+    static FleetScores sc;
+    score_fleet(p->pickup_x, p->pickup_y, D, capLimit, &sc);
+
+    int usedRelaxed, scored = 0;
+    int chosenTruck = choose_truck(info, trucks, fleetOrder, D, &sc, turn, &usedRelaxed, &scored);
+    PROF_COUNT(CTR_CANDIDATES, scored);
+
+    if (chosenTruck != -1) {
+        if (give_to_truck(info, &trucks[chosenTruck])) {
+            mark_truck_dirty(chosenTruck);
+            if (usedRelaxed) LOG_INFO(EV_RELAXED, chosenTruck, pkgId, fleet.load[chosenTruck]);
+        } else {
+            LOG_INFO(EV_LIST_FULL, chosenTruck, pkgId);
+            unassignedIds[unassignedCount++] = pkgId;
+        }
+    } else {
+        LOG_INFO(EV_NO_TRUCK, -1, pkgId);
+        unassignedIds[unassignedCount++] = pkgId;
+    }
+}
+
+// Zone half of assignPackagesToTrucks: every zone takes up to batch
+// packages from the front of the queue and places them on its own trucks.
+// Relays are planned first, as they look at the whole fleet.
+static void zone_assign_run(ZoneJob *job) {
+    int z = job->zone;
+    FleetScores sc;
+
+    for (int i = 0; i < zonePkgCount[z]; i++) {
+        PackageInfo *info = &allPackages[zonePkgs[z][i]];
+        PackageRequest *p = &info->pkg;
+
+        memset(sc.capOk, 0, sizeof(sc.capOk));
+        for (int k = 0; k < zoneTruckCount[z]; k++) {
+            int t = zoneTrucks[z][k];
+            sc.toPickup[t] = (int16_t)manhattan(fleet.x[t], fleet.y[t], p->pickup_x, p->pickup_y);
+            sc.endToPickup[t] = (int16_t)manhattan(fleet.endX[t], fleet.endY[t], p->pickup_x, p->pickup_y);
+            sc.capOk[t >> 5] |= (uint32_t)(fleet.load[t] < job->capLimit) << (t & 31);
+        }
+
+        int usedRelaxed;
+        int t = choose_truck(info, job->trucks, zoneTrucks[z], zoneTruckCount[z], &sc,
+                             job->turn, &usedRelaxed, &job->scored);
+        if (t < 0 || !give_to_truck(info, &job->trucks[t])) {
+            info->assignedToTruck = -1;   // left for the boundary exchange
+        }
+    }
+}
+
+static void zones_assign(TruckInfo trucks[], int D, int turn, int batch, int capLimit) {
+    int taken = 0, kept = 0;
+    for (int z = 0; z < zoneCount; z++) zonePkgCount[z] = 0;
+
+    for (int i = 0; i < unassignedCount; i++) {
+        int pkgId = unassignedIds[i];
+        if (!allPackages[pkgId].used) continue;
+
+        PackageRequest *p = &allPackages[pkgId].pkg;
+        int z = zone_of(p->pickup_x, p->pickup_y);
+        if (zonePkgCount[z] < batch) {
+            zonePkgs[z][zonePkgCount[z]++] = pkgId;
+            taken++;
+        } else {
+            unassignedIds[kept++] = pkgId;
+        }
+    }
+    unassignedCount = kept;
+    if (taken == 0) return;
+
+    for (int z = 0; z < zoneCount; z++) {
+        for (int i = 0; i < zonePkgCount[z]; i++) {
+            maybe_plan_relay(&allPackages[zonePkgs[z][i]], D, gridN);
+        }
+    }
+
+    ZoneJob jobs[MAX_ZONES];
+    for (int z = 0; z < zoneCount; z++) {
+        jobs[z] = (ZoneJob){zone_assign_run, z, turn, capLimit, trucks, 0};
+    }
+    zones_run(jobs);
+
+    // Boundary exchange: whatever a zone could not place gets the whole
+    // fleet, at most batch packages a turn as without zones; the rest wait
+    // at the back of the queue.
+    int exchanges = 0;
+    for (int z = 0; z < zoneCount; z++) {
+        PROF_COUNT(CTR_CANDIDATES, jobs[z].scored);
+        for (int i = 0; i < zonePkgCount[z]; i++) {
+            int pkgId = zonePkgs[z][i];
+            int t = allPackages[pkgId].assignedToTruck;
+            if (t >= 0) {
+                mark_truck_dirty(t);
+            } else if (exchanges < batch) {
+                exchanges++;
+                PROF_COUNT(CTR_ZONE_EXCHANGES, 1);
+                assign_one(trucks, D, turn, pkgId, capLimit);
+            } else {
+                unassignedIds[unassignedCount++] = pkgId;
+            }
+        }
+    }
+}
+
+void assignPackagesToTrucks(TruckInfo trucks[], int D, int turn) {
+    const int BATCH_SIZE = params.batchSize;
+    const int MAX_CAPACITY = params.maxCapacity;   // soft capacity limit for planning
+
+    if (zoneCount > 0) {
+        zones_assign(trucks, D, turn, BATCH_SIZE, MAX_CAPACITY);
+    } else {
+        int batch = unassignedCount < BATCH_SIZE ? unassignedCount : BATCH_SIZE;
+
+        for (int b = 0; b < batch; b++) {
+            if (unassignedCount == 0) break;
+
+            // Pop from front of queue
+            int pkgId = unassignedIds[0];
+            for (int i = 1; i < unassignedCount; i++) {
+                unassignedIds[i - 1] = unassignedIds[i];
+            }
+            unassignedCount--;
+
+            if (!allPackages[pkgId].used) {
+                //printf("[Assign] Package %d is not marked used, skipping.\n", pkgId);
+                continue;
+            }
+            assign_one(trucks, D, turn, pkgId, MAX_CAPACITY);
+        }
+    }
+
+    // Summary debug print
+    //printf("=== Assignment batch complete. Unassigned remaining = %d ===\n", unassignedCount);
+#if LOG_LEVEL >= LOG_LEVEL_DEBUG
+    for (int t = 0; t < D; t++) {
+        LOG_DEBUG(EV_ASSIGN_SUMMARY, t,
+                  trucks[t].currentPackageCount, trucks[t].assignedCount);
+        LOG_DEBUG_IDS(trucks[t].assignedPackageIds, trucks[t].assignedCount);
+    }
+#endif
+}
+
+
+// ---- Route policies ----
+// How a loaded truck picks the next dropoff. The rollout planner below
+// chooses one policy per turn for the whole fleet.
+
+#define ROUTE_SLACK    0   // at-risk-but-saveable first (least slack), else nearest
+#define ROUTE_NEAREST  1   // always the nearest dropoff
+#define ROUTE_EDF      2   // earliest deadline among saveable, else nearest
+#define ROUTE_POLICIES 3
+
+static int routePolicy = ROUTE_SLACK;
+
+typedef int (*DistFn)(int x1, int y1, int x2, int y2);
+
+// Pick which onboard package (ids[0..n)) to deliver next from (x,y).
+// Returns 1 and the target cell/distance if there is one.
+//
+// If stable is not NULL it receives how many more turns the choice is
+// certain to hold while the truck heads for the target. On the way the
+// target's slack stays put and any other package's slack drops by at most
+// 2 per turn, so the nearest and EDF choices hold until something else
+// happens. The slack choice can flip once another package could turn
+// at risk, or could undercut an at-risk target.
+int pick_dropoff_target(int policy, DistFn dist, int x, int y, int turn, int wait,
+                        const int ids[], int n, int *tx, int *ty, int *outDist,
+                        int *stable) {
+    int bestKey = INT_MAX, bestDist = INT_MAX, best = -1;
+
+    if (policy != ROUTE_NEAREST) {
+        for (int i = 0; i < n; i++) {
+            int pkgId = ids[i];
+            if (pkgId < 0 || !allPackages[pkgId].used) continue;
+
+            PackageRequest *p = &allPackages[pkgId].pkg;
+            int d = dist(x, y, p->dropoff_x, p->dropoff_y);
+            int slack = p->expiry_turn - (turn + wait + d + 1);
+            if (slack < 0) continue;
+            if (policy == ROUTE_SLACK && slack > AT_RISK_SLACK) continue;
+
+            int key = (policy == ROUTE_SLACK) ? slack : p->expiry_turn;
+            if (key < bestKey || (key == bestKey && d < bestDist)) {
+                bestKey = key;
+                bestDist = d;
+                best = pkgId;
+            }
+        }
+    }
+
+    if (best == -1) {
+        for (int i = 0; i < n; i++) {
+            int pkgId = ids[i];
+            if (pkgId < 0 || !allPackages[pkgId].used) continue;
+
+            PackageRequest *p = &allPackages[pkgId].pkg;
+            int d = dist(x, y, p->dropoff_x, p->dropoff_y);
+            if (d < bestDist) {
+                bestDist = d;
+                best = pkgId;
+            }
+        }
+    }
+
+    if (best == -1) return 0;
+    *tx = allPackages[best].pkg.dropoff_x;
+    *ty = allPackages[best].pkg.dropoff_y;
+    *outDist = bestDist;
 
-        if ( (next - guess < epsilon && next - guess > -epsilon) )
-            return next;
+    if (stable != NULL) {
+        *stable = INT_MAX;
+        if (policy == ROUTE_SLACK) {
+            int atRisk = (bestKey != INT_MAX);
+            int threshold = atRisk ? bestKey : AT_RISK_SLACK;
+            for (int i = 0; i < n; i++) {
+                int pkgId = ids[i];
+                if (pkgId < 0 || pkgId == best || !allPackages[pkgId].used) continue;
 
-        guess = next;
+                PackageRequest *p = &allPackages[pkgId].pkg;
+                int slack = p->expiry_turn - (turn + wait + dist(x, y, p->dropoff_x, p->dropoff_y) + 1);
+                if (slack < 0) continue;   // never becomes saveable again
+                int safe = (slack > threshold) ? (slack - threshold - 1) / 2 : 0;
+                if (safe < *stable) *stable = safe;
+            }
+        }
     }
+    return 1;
 }
 
 
-void compute_truck_dropoff_centroid(const TruckInfo *t, double *cx, double *cy) {
-    double sumX = 0.0, sumY = 0.0;
-    int count = 0;
+// ---- Fast-forward simulator ----
+// A private copy of the world that follows helper.c's turn rules: expiry
+// check, forced stay while paying a toll, drop-offs, then pickups (never
+// of a package dropped this turn), then moves, with the toll of the cell a
+// truck ends on applied unless it was already waiting (this includes a
+// truck that stays on a toll cell, as in the helper). Only tolls we have
+// learned are known to the simulator.
+//
+// Per-package state is split into chunks that clones share with their
+// parent until they first write to them, so forking a world copies the
+// truck table and a chunk pointer table, not the package table. All
+// storage is static: nothing is allocated while rolling out.
+
+#define SIM_CHUNK      64
+#define SIM_CHUNKS     ((MAX_TOTAL_PACKAGES + SIM_CHUNK - 1) / SIM_CHUNK)
+#define SIM_HORIZON    30      // turns simulated per candidate
+#define SIM_MAX_LIVE   (MAX_TRUCKS * TRUCK_MAX_CAP * 2)
+
+#define SIM_WAITING    0
+#define SIM_ON_TRUCK   1
+#define SIM_DELIVERED  2
+
+typedef struct SimPkg {
+    int8_t status;
+    int8_t expired;        // counted as expired already
+    int8_t moved;          // dropped this turn, cannot be picked up again
+    int16_t x, y;          // location while waiting
+} SimPkg;
+
+typedef struct SimChunk {
+    SimPkg p[SIM_CHUNK];
+} SimChunk;
+
+typedef struct SimTruck {
+    int16_t x, y;
+    int16_t wait;          // toll turns left
+    int16_t onboard;
+    int16_t assigned;
+    int onboardIds[TRUCK_MAX_CAP];
+    int assignedIds[TRUCK_MAX_CAP];
+} SimTruck;
+
+typedef struct SimWorld {
+    int turn;
+    int D;
+    int expired;
+    int delivered;
+    SimTruck trucks[MAX_TRUCKS];
+    SimChunk *chunk[SIM_CHUNKS];       // shared until written
+    uint8_t owned[SIM_CHUNKS];         // 1 if chunk[] points into arena
+    SimChunk arena[SIM_CHUNKS];        // private copies, used on first write
+} SimWorld;
+
+// Packages the rollout has to look at every turn: everything onboard or
+// assigned when the base world was built. Shared read-only by all clones.
+static int simLive[SIM_MAX_LIVE];
+static int simLiveCount;
+
+static SimWorld simBase;
+static SimWorld simCandidate[ROUTE_POLICIES];
+
+static const SimPkg *sim_pkg(const SimWorld *w, int id) {
+    return &w->chunk[id / SIM_CHUNK]->p[id % SIM_CHUNK];
+}
 
-    // onboard packages: use dropoffs
-    for (int i = 0; i < t->currentPackageCount; i++) {
-        int pid = t->packageIds[i];
-        if (pid < 0) continue;
-        PackageRequest *p = &allPackages[pid].pkg;
-        sumX += p->dropoff_x;
-        sumY += p->dropoff_y;
-        count++;
+static SimPkg *sim_pkg_mut(SimWorld *w, int id) {
+    int c = id / SIM_CHUNK;
+    if (!w->owned[c]) {
+        w->arena[c] = *w->chunk[c];
+        w->chunk[c] = &w->arena[c];
+        w->owned[c] = 1;
     }
+    return &w->chunk[c]->p[id % SIM_CHUNK];
+}
 
-    // assigned but not yet picked
-    for (int i = 0; i < t->assignedCount; i++) {
-        int pid = t->assignedPackageIds[i];
-        if (pid < 0) continue;
-        PackageRequest *p = &allPackages[pid].pkg;
-        sumX += p->dropoff_x;
-        sumY += p->dropoff_y;
-        count++;
+// Snapshot the planner's view of the world into simBase.
+void sim_build_base(TruckInfo trucks[], int D, int turn) {
+    SimWorld *w = &simBase;
+    w->turn = turn - 1;   // sim_step advances to `turn` first
+    w->D = D;
+    w->expired = 0;
+    w->delivered = 0;
+    for (int c = 0; c < SIM_CHUNKS; c++) {
+        w->chunk[c] = &w->arena[c];
+        w->owned[c] = 1;
     }
 
-    if (count == 0) {
-        // no targets yet: use current truck position
-        *cx = (double)t->x;
-        *cy = (double)t->y;
-    } else {
-        *cx = sumX / count;
-        *cy = sumY / count;
+    simLiveCount = 0;
+    for (int t = 0; t < D; t++) {
+        TruckInfo *truck = &trucks[t];
+        SimTruck *st = &w->trucks[t];
+        st->x = truck->x;
+        st->y = truck->y;
+        st->wait = truck->turnsInToll;
+        st->onboard = truck->currentPackageCount;
+        st->assigned = truck->assignedCount;
+
+        for (int i = 0; i < truck->currentPackageCount; i++) {
+            int id = truck->packageIds[i];
+            st->onboardIds[i] = id;
+            SimPkg *sp = &w->arena[id / SIM_CHUNK].p[id % SIM_CHUNK];
+            sp->status = SIM_ON_TRUCK;
+            sp->expired = turn - 1 > allPackages[id].pkg.expiry_turn;
+            sp->moved = 0;
+            simLive[simLiveCount++] = id;
+        }
+        for (int i = 0; i < truck->assignedCount; i++) {
+            int id = truck->assignedPackageIds[i];
+            st->assignedIds[i] = id;
+            SimPkg *sp = &w->arena[id / SIM_CHUNK].p[id % SIM_CHUNK];
+            sp->status = SIM_WAITING;
+            sp->expired = turn - 1 > allPackages[id].pkg.expiry_turn;
+            sp->moved = 0;
+            sp->x = allPackages[id].pkg.pickup_x;
+            sp->y = allPackages[id].pkg.pickup_y;
+            simLive[simLiveCount++] = id;
+        }
     }
 }
 
-// Compute cosine similarity between two 2D vectors.
-double cosine_similarity(double ax, double ay, double bx, double by) {
-    double dot = ax * bx + ay * by;
-    double na = sqrt1(ax * ax + ay * ay);
-    double nb = sqrt1(bx * bx + by * by);
-    if (na == 0.0 || nb == 0.0) return 1.0;
-    return dot / (na * nb);
+// Cheap copy of src: trucks are copied, package chunks are shared.
+void sim_clone(SimWorld *dst, const SimWorld *src) {
+    dst->turn = src->turn;
+    dst->D = src->D;
+    dst->expired = src->expired;
+    dst->delivered = src->delivered;
+    memcpy(dst->trucks, src->trucks, src->D * sizeof(SimTruck));
+    memcpy(dst->chunk, src->chunk, sizeof(dst->chunk));
+    memset(dst->owned, 0, sizeof(dst->owned));
 }
 
-// Compute approximate route length for a truck:
-int compute_truck_route_length(const TruckInfo *t, int *lastX, int *lastY) {
-    int cx = t->x;
-    int cy = t->y;
-    int total = 0;
+static char sim_step_towards(int x, int y, int tx, int ty) {
+    if (tx != x) return (tx > x) ? 'r' : 'l';
+    if (ty != y) return (ty > y) ? 'd' : 'u';
+    return 's';
+}
 
-    // onboard: go to each dropoff
-    for (int i = 0; i < t->currentPackageCount; i++) {
-        int pid = t->packageIds[i];
-        if (pid < 0) continue;
-        PackageRequest *p = &allPackages[pid].pkg;
-        total += manhattan(cx, cy, p->dropoff_x, p->dropoff_y);
-        cx = p->dropoff_x;
-        cy = p->dropoff_y;
+// Advance one turn with every truck following `policy`.
+void sim_step(SimWorld *w, int policy) {
+    w->turn++;
+
+    for (int i = 0; i < simLiveCount; i++) {
+        int id = simLive[i];
+        const SimPkg *sp = sim_pkg(w, id);
+        if (sp->moved) sim_pkg_mut(w, id)->moved = 0;
+        if (sp->status != SIM_DELIVERED && !sp->expired &&
+            w->turn > allPackages[id].pkg.expiry_turn) {
+            sim_pkg_mut(w, id)->expired = 1;
+            w->expired++;
+        }
     }
 
-    // assigned: pickup then dropoff
-    for (int i = 0; i < t->assignedCount; i++) {
-        int pid = t->assignedPackageIds[i];
-        if (pid < 0) continue;
-        PackageRequest *p = &allPackages[pid].pkg;
+    for (int t = 0; t < w->D; t++) {
+        SimTruck *st = &w->trucks[t];
+        int wasInToll = st->wait > 0;
+        if (wasInToll) st->wait--;
+
+        char move = 's';
+        int acted = 0;
+
+        // Drop-off at a destination
+        for (int i = 0; i < st->onboard && !acted; i++) {
+            int id = st->onboardIds[i];
+            PackageRequest *p = &allPackages[id].pkg;
+            if (p->dropoff_x == st->x && p->dropoff_y == st->y) {
+                SimPkg *sp = sim_pkg_mut(w, id);
+                if (allPackages[id].relayLeg) {
+                    sp->status = SIM_WAITING;   // handed off; next leg not simulated
+                    sp->x = st->x;
+                    sp->y = st->y;
+                } else {
+                    sp->status = SIM_DELIVERED;
+                    w->delivered++;
+                }
+                sp->moved = 1;
+                st->onboardIds[i] = st->onboardIds[--st->onboard];
+                acted = 1;
+            }
+        }
 
-        total += manhattan(cx, cy, p->pickup_x, p->pickup_y);
-        cx = p->pickup_x;
-        cy = p->pickup_y;
+        // Pickup of an assigned package waiting here
+        for (int i = 0; i < st->assigned && !acted; i++) {
+            int id = st->assignedIds[i];
+            const SimPkg *sp = sim_pkg(w, id);
+            if (sp->status == SIM_WAITING && !sp->moved &&
+                sp->x == st->x && sp->y == st->y && st->onboard < TRUCK_MAX_CAP) {
+                sim_pkg_mut(w, id)->status = SIM_ON_TRUCK;
+                st->assignedIds[i] = st->assignedIds[--st->assigned];
+                st->onboardIds[st->onboard++] = id;
+                acted = 1;
+            }
+        }
 
-        total += manhattan(cx, cy, p->dropoff_x, p->dropoff_y);
-        cx = p->dropoff_x;
-        cy = p->dropoff_y;
+        if (!acted && !wasInToll) {
+            int tx, ty, d;
+            if (pick_dropoff_target(policy, manhattan, st->x, st->y, w->turn, st->wait,
+                                    st->onboardIds, st->onboard, &tx, &ty, &d, NULL)) {
+                move = sim_step_towards(st->x, st->y, tx, ty);
+            } else {
+                int best = INT_MAX;
+                for (int i = 0; i < st->assigned; i++) {
+                    const SimPkg *sp = sim_pkg(w, st->assignedIds[i]);
+                    int dd = manhattan(st->x, st->y, sp->x, sp->y);
+                    if (dd < best) {
+                        best = dd;
+                        move = sim_step_towards(st->x, st->y, sp->x, sp->y);
+                    }
+                }
+            }
+        }
+
+        if (move == 'u') st->y--;
+        else if (move == 'd') st->y++;
+        else if (move == 'l') st->x--;
+        else if (move == 'r') st->x++;
+
+        int toll = knownToll[cell_of(st->x, st->y)];
+        if (toll > 0 && !wasInToll) st->wait = toll;
     }
+}
 
-    if (lastX) *lastX = cx;
-    if (lastY) *lastY = cy;
-    return total;
+// Remaining Manhattan work, used to break ties between equal outcomes.
+static long sim_remaining_work(const SimWorld *w) {
+    long work = 0;
+    for (int t = 0; t < w->D; t++) {
+        const SimTruck *st = &w->trucks[t];
+        for (int i = 0; i < st->onboard; i++) {
+            PackageRequest *p = &allPackages[st->onboardIds[i]].pkg;
+            work += manhattan(st->x, st->y, p->dropoff_x, p->dropoff_y);
+        }
+        for (int i = 0; i < st->assigned; i++) {
+            const SimPkg *sp = sim_pkg(w, st->assignedIds[i]);
+            work += manhattan(st->x, st->y, sp->x, sp->y);
+        }
+    }
+    return work;
 }
 
+typedef struct RolloutJob {
+    int policy;
+    int horizon;
+    SimWorld *world;
+} RolloutJob;
+
+static void *rollout_run(void *arg) {
+    RolloutJob *job = arg;
+    sim_clone(job->world, &simBase);
+    for (int k = 0; k < job->horizon; k++) {
+        sim_step(job->world, job->policy);
+    }
+    return NULL;
+}
 
-void assignPackagesToTrucks(TruckInfo trucks[], int D) {
-    const int BATCH_SIZE = 10;
-    const int MAX_CAPACITY = 5;       // soft capacity limit for planning
-    const int INF = 1000000000;
+// Roll every route policy SIM_HORIZON turns ahead from the current state,
+// one thread per policy, and keep the one with the fewest projected
+// expirations (then most deliveries, then least work left).
+int choose_route_policy(TruckInfo trucks[], int D, int turn) {
+    sim_build_base(trucks, D, turn);
+    if (simLiveCount == 0) return routePolicy;
+
+    RolloutJob jobs[ROUTE_POLICIES];
+    pthread_t threads[ROUTE_POLICIES];
+    int started[ROUTE_POLICIES];
+
+    for (int k = 0; k < ROUTE_POLICIES; k++) {
+        jobs[k].policy = k;
+        jobs[k].horizon = SIM_HORIZON;
+        jobs[k].world = &simCandidate[k];
+        started[k] = pthread_create(&threads[k], NULL, rollout_run, &jobs[k]) == 0;
+        if (!started[k]) rollout_run(&jobs[k]);
+    }
 
-    int batch = unassignedCount < BATCH_SIZE ? unassignedCount : BATCH_SIZE;
+    int best = ROUTE_SLACK;
+    long bestWork = -1;
+    for (int k = 0; k < ROUTE_POLICIES; k++) {
+        if (started[k]) pthread_join(threads[k], NULL);
+
+        SimWorld *w = jobs[k].world;
+        long work = sim_remaining_work(w);
+        SimWorld *b = jobs[best].world;
+        if (bestWork < 0 ||
+            w->expired < b->expired ||
+            (w->expired == b->expired && w->delivered > b->delivered) ||
+            (w->expired == b->expired && w->delivered == b->delivered && work < bestWork)) {
+            best = k;
+            bestWork = work;
+        }
+    }
 
+    LOG_INFO(EV_ROLLOUT, -1, best, simCandidate[best].expired, simCandidate[best].delivered);
+    return best;
+}
 
-    for (int b = 0; b < batch; b++) {
-        if (unassignedCount == 0) break;
 
-        // Pop from front of queue
-        int pkgId = unassignedIds[0];
-        for (int i = 1; i < unassignedCount; i++) {
-            unassignedIds[i - 1] = unassignedIds[i];
-        }
-        unassignedCount--;
+// ---- Demand heatmap & idle repositioning ----
+// Pickup arrivals are binned into coarse blocks with exponentially decaying
+// weights, giving each block an arrival-rate estimate. Trucks with nothing
+// onboard or assigned drift towards blocks where demand is expected but
+// few trucks will be. Empty trucks need no auth string, so this is free
+// apart from the planning itself.
+
+#define DEMAND_BLOCKS      16     // blocks per side (fewer on small grids)
+#define DEMAND_DECAY       0.98   // per-turn weight decay (~35 turn half-life)
+#define DEMAND_HORIZON     20     // turns of expected arrivals a move is worth
+#define DEMAND_MIN_GAIN    0.5    // expected pickups needed to bother moving
+#define DEMAND_RETARGET    10     // turns between re-choosing a target
+
+static int demandSide;                 // blocks per side
+static int demandBlock;                // cells per block side
+static double demandHeat[DEMAND_BLOCKS][DEMAND_BLOCKS];
+static int demandHeatTurn;             // turn the heat was last decayed to
+static double demandTotal;             // decayed arrivals over all blocks
+static int demandLastArrival;          // no arrivals after this turn (T)
+
+static int idleTargetX[MAX_TRUCKS];    // -1 when the truck has no target
+static int idleTargetY[MAX_TRUCKS];
+static int idleTargetTurn[MAX_TRUCKS];
+
+void demand_init(int N, int T) {
+    demandSide = N < DEMAND_BLOCKS ? N : DEMAND_BLOCKS;
+    demandBlock = (N + demandSide - 1) / demandSide;
+    demandLastArrival = T;
+    for (int t = 0; t < MAX_TRUCKS; t++) idleTargetX[t] = idleTargetY[t] = -1;
+}
 
-        PackageInfo *info = &allPackages[pkgId];
-        if (!info->used) {
-            //printf("[Assign] Package %d is not marked used, skipping.\n", pkgId);
-            continue;
-        }
+static void demand_decay_to(int turn) {
+    if (turn <= demandHeatTurn) return;
 
-        PackageRequest *p = &info->pkg;
-        int bestTruckStrict = -1;
-        int bestCostStrict = INF;
-        int bestLoadStrict = INF;
+    double f = 1.0;
+    for (int k = demandHeatTurn; k < turn; k++) f *= DEMAND_DECAY;
+    for (int i = 0; i < demandSide; i++)
+        for (int j = 0; j < demandSide; j++)
+            demandHeat[i][j] *= f;
+    demandTotal *= f;
+    demandHeatTurn = turn;
+}
 
-        int bestTruckRelax = -1;
-        int bestDistRelax = INF;
-        int bestLoadRelax = INF;
+void demand_record(int x, int y, int turn) {
+    demand_decay_to(turn);
+    demandHeat[x / demandBlock][y / demandBlock] += 1.0;
+    demandTotal += 1.0;
+}
 
-        // Try all trucks
-        for (int t = 0; t < D; t++) {
-            TruckInfo *truck = &trucks[t];
+// Choose a block for every idle truck. Each candidate block is worth the
+// pickups expected there over the horizon, shared with the trucks that
+// already cover it, minus the time spent getting there.
+void plan_idle_repositioning(TruckInfo trucks[], int D, int turn) {
+    demand_decay_to(turn);
 
-            // Capacity check (onboard + already assigned)
-            int plannedLoad = truck->currentPackageCount + truck->assignedCount;
-            if (plannedLoad >= MAX_CAPACITY) {
-                // printf("  Truck %d: capacity limit reached (%d)\n", t, plannedLoad);
-                continue;
-            }
+    // Decayed count / (1 - decay) is the steady-state arrivals per turn.
+    double ratePerTurn = demandTotal * (1.0 - DEMAND_DECAY);
+    int active = turn < demandLastArrival && ratePerTurn > 0.0;
 
-            // Distance to pickup
-            int dist_to_pickup = manhattan(truck->x, truck->y, p->pickup_x, p->pickup_y);
+    int cover[DEMAND_BLOCKS][DEMAND_BLOCKS];
+    memset(cover, 0, sizeof(cover));
+    for (int t = 0; t < D; t++) {
+        TruckInfo *truck = &trucks[t];
+        int idle = truck->currentPackageCount == 0 && truck->assignedCount == 0;
+        if (!idle) {
+            cover[fleet.endX[t] / demandBlock][fleet.endY[t] / demandBlock]++;
+        } else if (idleTargetX[t] >= 0 && turn - idleTargetTurn[t] < DEMAND_RETARGET) {
+            cover[idleTargetX[t] / demandBlock][idleTargetY[t] / demandBlock]++;
+        }
+    }
 
-            if (dist_to_pickup < bestDistRelax ||
-                (dist_to_pickup == bestDistRelax && plannedLoad < bestLoadRelax) ||
-                (dist_to_pickup == bestDistRelax && plannedLoad == bestLoadRelax && t < bestTruckRelax))
-            {
-                bestDistRelax = dist_to_pickup;
-                bestLoadRelax = plannedLoad;
-                bestTruckRelax = t;
-            }
+    for (int t = 0; t < D; t++) {
+        TruckInfo *truck = &trucks[t];
+        int idle = truck->currentPackageCount == 0 && truck->assignedCount == 0;
 
-            int max_dist = (truck->currentPackageCount > 2) ? 3 : 4;
-            if (dist_to_pickup > max_dist) {
-                continue;
-            }
+        if (!idle || !active) {
+            idleTargetX[t] = idleTargetY[t] = -1;
+            continue;
+        }
+        if (idleTargetX[t] >= 0 && turn - idleTargetTurn[t] < DEMAND_RETARGET) {
+            continue;   // keep heading where we were going
+        }
 
-            // Direction similarity
-            double cx, cy;
-            compute_truck_dropoff_centroid(truck, &cx, &cy);
-
-            double truck_vec_x = cx - truck->x;
-            double truck_vec_y = cy - truck->y;
-
-            double pkg_vec_x = (double)p->dropoff_x - (double)p->pickup_x;
-            double pkg_vec_y = (double)p->dropoff_y - (double)p->pickup_y;
-
-            double sim = cosine_similarity(truck_vec_x, truck_vec_y,
-                                           pkg_vec_x, pkg_vec_y);
-
-            // Route insertion cost: appending pickup+dropoff at end
-            int lastX, lastY;
-            int baseLen = compute_truck_route_length(truck, &lastX, &lastY);
-            int extra = manhattan(lastX, lastY, p->pickup_x, p->pickup_y)
-                        + manhattan(p->pickup_x, p->pickup_y, p->dropoff_x, p->dropoff_y);
-            int insertion_cost = extra;
-
-            int limit = (sim > 0.7) ? 4 : 2;
-
-            // STRICT candidate: must satisfy insertion_cost <= limit
-            if (insertion_cost <= limit) {
-                if (insertion_cost < bestCostStrict ||
-                    (insertion_cost == bestCostStrict && plannedLoad < bestLoadStrict) ||
-                    (insertion_cost == bestCostStrict && plannedLoad == bestLoadStrict && t < bestTruckStrict))
-                {
-                    bestCostStrict = insertion_cost;
-                    bestLoadStrict = plannedLoad;
-                    bestTruckStrict = t;
+        int hereI = truck->x / demandBlock, hereJ = truck->y / demandBlock;
+        double bestGain = -1.0;
+        int bestI = hereI, bestJ = hereJ;
+
+        for (int i = 0; i < demandSide; i++) {
+            for (int j = 0; j < demandSide; j++) {
+                double share = demandHeat[i][j] / demandTotal;
+                double expected = share * ratePerTurn * DEMAND_HORIZON;
+                int cx = i * demandBlock + demandBlock / 2;
+                int cy = j * demandBlock + demandBlock / 2;
+                if (cx >= gridN) cx = gridN - 1;
+                if (cy >= gridN) cy = gridN - 1;
+
+                int trip = (i == hereI && j == hereJ) ? 0 : travel_time(truck->x, truck->y, cx, cy);
+                double gain = expected / (1 + cover[i][j])
+                            * (1.0 - (double)trip / (trip + DEMAND_HORIZON));
+                if (gain > bestGain) {
+                    bestGain = gain;
+                    bestI = i;
+                    bestJ = j;
                 }
             }
         }
 
-        int chosenTruck = -1;
-        int usedRelaxed = 0;
-
-        if (bestTruckStrict != -1) {
-            chosenTruck = bestTruckStrict;
-        } else if (bestTruckRelax != -1) {
-            chosenTruck = bestTruckRelax;
-            usedRelaxed = 1;
+        if (bestGain < DEMAND_MIN_GAIN || (bestI == hereI && bestJ == hereJ)) {
+            idleTargetX[t] = idleTargetY[t] = -1;
+            cover[hereI][hereJ]++;
+            continue;
         }
 
-        if (chosenTruck != -1) {
-            TruckInfo *bestTruck = &trucks[chosenTruck];
+        idleTargetX[t] = bestI * demandBlock + demandBlock / 2;
+        idleTargetY[t] = bestJ * demandBlock + demandBlock / 2;
+        if (idleTargetX[t] >= gridN) idleTargetX[t] = gridN - 1;
+        if (idleTargetY[t] >= gridN) idleTargetY[t] = gridN - 1;
+        idleTargetTurn[t] = turn;
+        cover[bestI][bestJ]++;
+    }
+}
 
-            int idx = bestTruck->assignedCount;
-            if (idx < TRUCK_MAX_CAP) {
-                bestTruck->assignedPackageIds[idx] = pkgId;
-                bestTruck->assignedCount++;
 
-                info->assignedToTruck = chosenTruck;
+// Cached next target of every truck, recomputed only when the truck is
+// dirty, the world or route policy changed, or the choice's margin ran out.
+static int planTargetX[MAX_TRUCKS], planTargetY[MAX_TRUCKS];
+static int planHasTarget[MAX_TRUCKS];
+static int planValidUntil[MAX_TRUCKS];
 
-                if (!usedRelaxed) {
-            
-                } else {
-                    //printf("[Assign] Package %d assigned to truck %d (RELAXED fallback, dist_to_pickup=%d, load=%d)\n",pkgId, chosenTruck, bestDistRelax, bestLoadRelax);
-                }
-            } else {
-                //printf("[Assign] WARNING: truck %d assigned list full, re-queuing package %d\n",chosenTruck, pkgId);
-                unassignedIds[unassignedCount++] = pkgId;
+// Next dropoff by the route policy, else the nearest assigned pickup.
+static void plan_truck_target(TruckInfo *truck, int turn) {
+    int t = truck->id;
+    int bestDist = INT_MAX;
+    int stable = INT_MAX;
+    int targetX = truck->x;
+    int targetY = truck->y;
+
+    int haveTarget = pick_dropoff_target(routePolicy, travel_time, truck->x, truck->y, turn,
+                                         truck->turnsInToll,
+                                         truck->packageIds, truck->currentPackageCount,
+                                         &targetX, &targetY, &bestDist, &stable);
+
+    if (!haveTarget) {
+        for (int i = 0; i < truck->assignedCount; i++) {
+            int pkgId = truck->assignedPackageIds[i];
+            if (pkgId < 0) continue;
+            if (!allPackages[pkgId].used) continue;
+
+            PackageRequest *p = &allPackages[pkgId].pkg;
+            int dist = travel_time(truck->x, truck->y, p->pickup_x, p->pickup_y);
+
+            if (dist < bestDist) {
+                bestDist = dist;
+                targetX = p->pickup_x;
+                targetY = p->pickup_y;
+                haveTarget = 1;
             }
-        } else {
-            printf("[Assign] No suitable truck found for package %d (even RELAXED), re-queued.\n", pkgId);
-            unassignedIds[unassignedCount++] = pkgId;
         }
     }
 
-    // Summary debug print
-    //printf("=== Assignment batch complete. Unassigned remaining = %d ===\n", unassignedCount);
-    for (int t = 0; t < D; t++) {
-        printf("  Truck %d: onboard=%d, assigned=%d -> [",
-               trucks[t].id, trucks[t].currentPackageCount, trucks[t].assignedCount);
-        for (int i = 0; i < trucks[t].assignedCount; i++) {
-            printf("%d", trucks[t].assignedPackageIds[i]);
-            if (i + 1 < trucks[t].assignedCount) printf(", ");
-        }
-        printf("]\n");
-    }
-}
+    // Leaving a toll cell can cost more than the 2 turns of slack a step
+    // is assumed to cost at most, so re-check next turn there.
+    if (knownToll[cell_of(truck->x, truck->y)] > 0) stable = 0;
 
+    planHasTarget[t] = haveTarget;
+    planTargetX[t] = targetX;
+    planTargetY[t] = targetY;
+    planValidUntil[t] = (stable > 1000000) ? INT_MAX : turn + 1 + stable;
+}
 
 void decide_truck_actions(int D,
                           TruckInfo trucks[],
                           PackageInfo allPackages[],
                           char truckMovementInstructions[],
                           int pickUpCommands[],
-                          int dropOffCommands[])
+                          int dropOffCommands[],
+                          int turn)
 {
+    static int cachedPolicy = -1;
+    int cacheOk = !worldDirty && cachedPolicy == routePolicy;
+    cachedPolicy = routePolicy;
+
     for (int t = 0; t < D; t++) {
         TruckInfo *truck = &trucks[t];
 
         char move = 's';          // default: stay in place
-        int doPickup = 0;
-        int doDropoff = 0;
+        int doPickup = -1;        // package id, or -1
+        int doDropoff = -1;       // package id, or -1
 
         int tx = truck->x;
         int ty = truck->y;
@@ -418,13 +2758,23 @@ void decide_truck_actions(int D,
             PackageRequest *p = &allPackages[pkgId].pkg;
             if (p->dropoff_x == tx && p->dropoff_y == ty) {
                 foundDropHere = 1;
+                doDropoff = pkgId;
+
+                if (allPackages[pkgId].relayLeg) {
+                    finish_relay_leg(&allPackages[pkgId], trucks, D, t, turn);
+                } else {
+                    allPackages[pkgId].delivered = 1;
+                    allPackages[pkgId].assignedToTruck = -1;
+                }
+                truck->packageIds[i] = truck->packageIds[truck->currentPackageCount - 1];
+                truck->packageIds[truck->currentPackageCount - 1] = -1;
+                truck->currentPackageCount--;
                 break;
             }
         }
 
         if (foundDropHere) {
             move = 's';
-            doDropoff = 1;
         } else {
 
             int foundPickupHere = 0;
@@ -434,115 +2784,345 @@ void decide_truck_actions(int D,
                 if (!allPackages[pkgId].used) continue;
 
                 PackageRequest *p = &allPackages[pkgId].pkg;
-                if (p->pickup_x == tx && p->pickup_y == ty) {
+                if (p->pickup_x == tx && p->pickup_y == ty &&
+                    truck->currentPackageCount < TRUCK_MAX_CAP &&
+                    allPackages[pkgId].droppedTurn != turn) {
                     foundPickupHere = 1;
+                    doPickup = pkgId;
+
+                    truck->assignedPackageIds[i] = truck->assignedPackageIds[truck->assignedCount - 1];
+                    truck->assignedPackageIds[truck->assignedCount - 1] = -1;
+                    truck->assignedCount--;
+                    truck->packageIds[truck->currentPackageCount++] = pkgId;
                     break;
                 }
             }
 
             if (foundPickupHere) {
                 move = 's';
-                doPickup = 1;
             } else {
-                
-                int bestDist = INT_MAX;
-                int targetX = tx;
-                int targetY = ty;
-                int haveTarget = 0;
-
-                
-                for (int i = 0; i < truck->currentPackageCount; i++) {
-                    int pkgId = truck->packageIds[i];
-                    if (pkgId < 0) continue;
-                    if (!allPackages[pkgId].used) continue;
-
-                    PackageRequest *p = &allPackages[pkgId].pkg;
-                    int dist = manhattan(tx, ty, p->dropoff_x, p->dropoff_y);
-
-                    if (dist < bestDist) {
-                        bestDist = dist;
-                        targetX = p->dropoff_x;
-                        targetY = p->dropoff_y;
-                        haveTarget = 1;
-                    }
+                if (!cacheOk || truckDirty[t] || turn >= planValidUntil[t]) {
+                    plan_truck_target(truck, turn);
                 }
 
-                
-                if (!haveTarget) {
-                    for (int i = 0; i < truck->assignedCount; i++) {
-                        int pkgId = truck->assignedPackageIds[i];
-                        if (pkgId < 0) continue;
-                        if (!allPackages[pkgId].used) continue;
-
-                        PackageRequest *p = &allPackages[pkgId].pkg;
-                        int dist = manhattan(tx, ty, p->pickup_x, p->pickup_y);
-
-                        if (dist < bestDist) {
-                            bestDist = dist;
-                            targetX = p->pickup_x;
-                            targetY = p->pickup_y;
-                            haveTarget = 1;
-                        }
-                    }
-                }
+                int haveTarget = planHasTarget[t];
+                int targetX = planTargetX[t];
+                int targetY = planTargetY[t];
 
-               
-                if (haveTarget && bestDist > 0) {
-                    int dx = targetX - tx;
-                    int dy = targetY - ty;
-
-                    if (dx != 0) {
-                        move = (dx > 0) ? 'r' : 'l';
-                    } else if (dy != 0) {
-                        move = (dy > 0) ? 'd' : 'u';
-                    } else {
-                        move = 's';
-                    }
+                if (haveTarget && (targetX != tx || targetY != ty)) {
+                    move = oracle_next_move(tx, ty, targetX, targetY);
+                } else if (!haveTarget && idleTargetX[t] >= 0 && truck->turnsInToll == 0) {
+                    move = oracle_next_move(tx, ty, idleTargetX[t], idleTargetY[t]);
                 } else {
                     move = 's';
                 }
             }
         }
 
+        // A pickup or drop-off changes this truck's route from next turn on.
+        truckDirty[t] = (doPickup != -1 || doDropoff != -1);
+        if (truckDirty[t]) planEvents++;
+
         // Write out
         truckMovementInstructions[t] = move;
         pickUpCommands[t] = doPickup;
         dropOffCommands[t] = doDropoff;
     }
+    worldDirty = 0;
 
     
-    printf("=== Movement Decisions This Turn ===\n");
+#if LOG_LEVEL >= LOG_LEVEL_DEBUG
+    LOG_DEBUG(EV_MOVES_BEGIN, -1, 0);
     for (int t = 0; t < D; t++) {
         TruckInfo *truck = &trucks[t];
 
-        printf("Truck %d at (%d,%d): move=%c, pickUp=%d, dropOff=%d\n",
-               truck->id,
-               truck->x, truck->y,
-               truckMovementInstructions[t],
-               pickUpCommands[t],
-               dropOffCommands[t]);
+        LOG_DEBUG(EV_MOVE, t, truck->x, truck->y, truckMovementInstructions[t],
+                  pickUpCommands[t], dropOffCommands[t]);
 
-        // Onboard packages
-        printf("   Onboard: [");
-        for (int i = 0; i < truck->currentPackageCount; i++) {
-            printf("%d", truck->packageIds[i]);
-            if (i + 1 < truck->currentPackageCount) printf(", ");
+        LOG_DEBUG(EV_ID_LIST, t, LOG_LIST_ONBOARD, truck->currentPackageCount);
+        LOG_DEBUG_IDS(truck->packageIds, truck->currentPackageCount);
+
+        LOG_DEBUG(EV_ID_LIST, t, LOG_LIST_ASSIGNED, truck->assignedCount);
+        LOG_DEBUG_IDS(truck->assignedPackageIds, truck->assignedCount);
+    }
+#endif
+}
+
+
+// ---- Queued turns ----
+// When nothing can change the decisions for a while (no unassigned
+// packages, no pickups or drops this turn, loaded trucks only sitting out a
+// toll), the coming turns are just empty trucks stepping towards cached
+// targets. Those are handed to the helper as a plan so it does not have to
+// wake us for them. Auth strings are per turn, so a loaded truck that moves
+// always needs us back.
+
+int plansEnabled = 0;   // off against a helper without TurnPlan in its shm
+
+void queue_turn_plan(MainSharedMemory *shm, int D, TruckInfo trucks[], int turn, int T) {
+    if (!plansEnabled) return;   // shm->plan lies past the attached segment
+    TurnPlan *plan = &shm->plan;
+    plan->length = 0;
+    if (unassignedCount > 0) return;
+
+    // Turns the planner would re-decide on anyway.
+    int len = PLAN_MAX_TURNS;
+    if (lastRolloutTurn + ROLLOUT_REFRESH - turn - 1 < len) len = lastRolloutTurn + ROLLOUT_REFRESH - turn - 1;
+    if (T - turn - 1 < len) len = T - turn - 1;
+
+    int posX[MAX_TRUCKS], posY[MAX_TRUCKS], wait[MAX_TRUCKS];
+    int targetX[MAX_TRUCKS], targetY[MAX_TRUCKS];
+    for (int t = 0; t < D && len > 0; t++) {
+        TruckInfo *truck = &trucks[t];
+        if (shm->pickUpCommands[t] != -1 || shm->dropOffCommands[t] != -1) return;
+
+        wait[t] = truck->turnsInToll > 0 ? truck->turnsInToll - 1 : 0;
+        posX[t] = truck->x;
+        posY[t] = truck->y;
+        targetX[t] = targetY[t] = -1;
+
+        if (truck->currentPackageCount > 0) {
+            if (wait[t] < len) len = wait[t];
+            continue;
         }
-        printf("]\n");
 
-        // Assigned packages
-        printf("   Assigned: [");
-        for (int i = 0; i < truck->assignedCount; i++) {
-            printf("%d", truck->assignedPackageIds[i]);
-            if (i + 1 < truck->assignedCount) printf(", ");
+        if (truck->turnsInToll == 0) {
+            char m = shm->truckMovementInstructions[t];
+            if (m == 'u') posY[t]--;
+            else if (m == 'd') posY[t]++;
+            else if (m == 'l') posX[t]--;
+            else if (m == 'r') posX[t]++;
+        }
+
+        if (planHasTarget[t]) {
+            if (posX[t] == planTargetX[t] && posY[t] == planTargetY[t]) return;
+            if (planValidUntil[t] - turn - 1 < len) len = planValidUntil[t] - turn - 1;
+            targetX[t] = planTargetX[t];
+            targetY[t] = planTargetY[t];
+        } else if (truck->assignedCount == 0) {
+            if (idleTargetX[t] < 0) {
+                if (turn < demandLastArrival && demandTotal > 0.0) return;  // re-chosen every turn
+                continue;
+            }
+            if (idleTargetTurn[t] + DEMAND_RETARGET - turn - 1 < len) len = idleTargetTurn[t] + DEMAND_RETARGET - turn - 1;
+            targetX[t] = idleTargetX[t];
+            targetY[t] = idleTargetY[t];
+        }
+    }
+    if (len <= 0) return;
+
+    // Step the empty trucks forward; the plan ends once one of them is at
+    // its pickup, where the next turn needs a real decision.
+    int steps = 0;
+    for (; steps < len; steps++) {
+        int arrived = 0;
+        for (int t = 0; t < D; t++) {
+            char m = 's';
+            if (wait[t] > 0) {
+                wait[t]--;
+            } else if (targetX[t] >= 0) {
+                m = oracle_next_move(posX[t], posY[t], targetX[t], targetY[t]);
+                if (m == 'u') posY[t]--;
+                else if (m == 'd') posY[t]++;
+                else if (m == 'l') posX[t]--;
+                else if (m == 'r') posX[t]++;
+                if (planHasTarget[t] && posX[t] == targetX[t] && posY[t] == targetY[t]) arrived = 1;
+            }
+            plan->truckMovementInstructions[steps][t] = m;
+            plan->pickUpCommands[steps][t] = -1;
+            plan->dropOffCommands[steps][t] = -1;
+        }
+        if (arrived) {
+            steps++;
+            break;
+        }
+    }
+
+    plan->stopOn = PLAN_STOP_TOLL;
+    plan->length = steps;
+}
+
+// Solver channels: a SysV queue id, or with SOLVER_BACKEND=socket an
+// inherited SOCK_SEQPACKET descriptor that carries the whole struct.
+int solverSocketBackend = 0;
+
+int solver_send(int solver, SolverRequest *req) {
+    if (solverSocketBackend) {
+        return send(solver, req, sizeof(SolverRequest), MSG_NOSIGNAL) == -1 ? -1 : 0;
+    }
+    return msgsnd(solver, req, sizeof(SolverRequest) - sizeof(long), 0);
+}
+
+int solver_recv(int solver, SolverResponse *resp) {
+    if (solverSocketBackend) {
+        return recv(solver, resp, sizeof(SolverResponse), 0) <= 0 ? -1 : 0;
+    }
+    return msgrcv(solver, resp, sizeof(SolverResponse) - sizeof(long), 4, 0) == -1 ? -1 : 0;
+}
+
+// Brute-force the auth string of the given length through one solver queue.
+// Guesses are enumerated as a base-4 counter over "udlr".
+int crack_auth_string(int solverMqId, int truckId, int length, char *out) {
+    const char letters[4] = {'u', 'd', 'l', 'r'};
+    SolverRequest req;
+    SolverResponse resp;
+
+    req.mtype = 2;
+    req.truckNumber = truckId;
+    req.authStringGuess[0] = '\0';
+    if (solver_send(solverMqId, &req) == -1) {
+        printf("solver send (target truck) failed: %s\n", strerror(errno));
+        return 1;
+    }
+    PROF_COUNT(CTR_RETARGETS, 1);
+
+    int digits[TRUCK_MAX_CAP];
+    for (int i = 0; i < length; i++) digits[i] = 0;
+
+    req.mtype = 3;
+    while (1) {
+        for (int i = 0; i < length; i++) {
+            req.authStringGuess[i] = letters[digits[i]];
+        }
+        req.authStringGuess[length] = '\0';
+
+        if (solver_send(solverMqId, &req) == -1 ||
+            solver_recv(solverMqId, &resp) == -1) {
+            printf("solver exchange failed: %s\n", strerror(errno));
+            return 1;
+        }
+        PROF_COUNT(CTR_GUESSES, 1);
+        PROF_COUNT(CTR_SOLVER_MESSAGES, 1);
+        if (resp.guessIsCorrect) {
+            strcpy(out, req.authStringGuess);
+            return 0;
+        }
+
+        int i = 0;
+        while (i < length && ++digits[i] == 4) {
+            digits[i++] = 0;
+        }
+        if (i == length) break;   // every string of this length tried
+    }
+    return 1;
+}
+
+// Packed guesses carry their truck, so one exchange can test candidates of
+// several trucks on any solver. A solver from a helper that predates them
+// rejects the bigger message outright, so they are opt-in: SOLVER_PACKED=1.
+int solverPacked = 0;
+
+int solver_send_packed(int solver, PackedGuessRequest *req) {
+    if (solverSocketBackend) return send(solver, req, sizeof(*req), MSG_NOSIGNAL) == -1 ? -1 : 0;
+    return msgsnd(solver, req, sizeof(*req) - sizeof(long), 0);
+}
+
+int solver_recv_packed(int solver, PackedGuessResponse *resp) {
+    if (solverSocketBackend) return recv(solver, resp, sizeof(*resp), 0) <= 0 ? -1 : 0;
+    return msgrcv(solver, resp, sizeof(*resp) - sizeof(long), 4, 0) == -1 ? -1 : 0;
+}
+
+// Every round fills one message per solver with the next candidates of the
+// movers not yet cracked, in order, sends them all and only then collects
+// the replies, so all S solvers work at once. Candidates of a truck run as
+// the same base-4 counter as crack_auth_string.
+static void crack_packed(MainSharedMemory *shm, const int movers[], int n, int S, int solverMqIds[]) {
+    static unsigned long long next[MAX_TRUCKS], end[MAX_TRUCKS];
+    static int solved[MAX_TRUCKS];
+    static int from[MAX_SOLVERS][PACKED_GUESS_MAX];
+    static PackedGuessRequest req[MAX_SOLVERS];
+    PackedGuessResponse resp;
+
+    for (int k = 0; k < n; k++) {
+        next[k] = 0;
+        end[k] = 1ULL << (2 * shm->truckPackageCount[movers[k]]);
+        solved[k] = 0;
+    }
+
+    int first = 0;   // movers before this are cracked or exhausted
+    int failed = 0;
+    while (!failed) {
+        int sent = 0;
+        for (int k = first; sent < S; ) {
+            PackedGuessRequest *r = &req[sent];
+            r->mtype = 3;
+            r->count = 0;
+            for (; k < n && r->count < PACKED_GUESS_MAX; k++) {
+                int t = movers[k], length = shm->truckPackageCount[t];
+                while (!solved[k] && next[k] < end[k] && r->count < PACKED_GUESS_MAX) {
+                    from[sent][r->count] = k;
+                    r->guesses[r->count++] = PACK_GUESS(t, length, next[k]++);
+                }
+                if (r->count == PACKED_GUESS_MAX) break;
+            }
+            if (r->count == 0) break;
+
+            if (solver_send_packed(solverMqIds[sent], r) == -1) {
+                printf("solver exchange failed: %s\n", strerror(errno));
+                failed = 1;
+                break;
+            }
+            PROF_COUNT(CTR_GUESSES, r->count);
+            PROF_COUNT(CTR_SOLVER_MESSAGES, 1);
+            sent++;
+        }
+        if (sent == 0) break;
+
+        // Every sent request is answered, even after a failure, so no stale
+        // reply is left in a solver's queue for the next turn.
+        for (int m = 0; m < sent; m++) {
+            if (solver_recv_packed(solverMqIds[m], &resp) == -1) {
+                printf("solver exchange failed: %s\n", strerror(errno));
+                failed = 1;
+                continue;
+            }
+            for (int w = 0; w < PACKED_GUESS_MAX / 64; w++) {
+                for (unsigned long long bits = resp.hits[w]; bits; bits &= bits - 1) {
+                    int g = w * 64 + __builtin_ctzll(bits);
+                    if (g >= req[m].count) continue;
+                    int k = from[m][g], t = movers[k], length = shm->truckPackageCount[t];
+                    for (int i = 0; i < length; i++) {
+                        shm->authStrings[t][i] = "udlr"[(req[m].guesses[g] >> (2 * i)) & 3];
+                    }
+                    shm->authStrings[t][length] = '\0';
+                    solved[k] = 1;
+                }
+            }
         }
-        printf("]\n");
+        while (first < n && (solved[first] || next[first] == end[first])) first++;
+    }
+
+    for (int k = 0; k < n; k++) {
+        if (!solved[k]) shm->truckMovementInstructions[movers[k]] = 's';
     }
 }
 
+// Only loaded trucks that actually move need an auth string; the length
+// is the package count the helper saw at the start of the turn.
+void fill_auth_strings(MainSharedMemory *shm, int D, int S, int solverMqIds[]) {
+    int movers[MAX_TRUCKS], n = 0;
+    for (int t = 0; t < D; t++) {
+        int length = shm->truckPackageCount[t];
+        if (length == 0 || shm->truckMovementInstructions[t] == 's') continue;
+        movers[n++] = t;
+    }
+
+    if (solverPacked) {
+        crack_packed(shm, movers, n, S, solverMqIds);
+        return;
+    }
+    for (int k = 0; k < n; k++) {
+        int t = movers[k];
+        if (crack_auth_string(solverMqIds[t % S], t, shm->truckPackageCount[t], shm->authStrings[t]) != 0) {
+            shm->truckMovementInstructions[t] = 's';
+        }
+    }
+}
 
 
 //Main
+// planbench.c includes this file for the planner kernels and has its own main.
+#ifndef PLANBENCH
 int main() {
     
     for (int i = 0; i < MAX_TOTAL_PACKAGES; i++) {
@@ -583,6 +3163,10 @@ int main() {
 
     MainSharedMemory *mainShmPtr;
     int shmId = shmget((key_t)shmKey, sizeof(MainSharedMemory), 0);
+    plansEnabled = (shmId != -1);
+    if (shmId == -1) {
+        shmId = shmget((key_t)shmKey, offsetof(MainSharedMemory, plan), 0);
+    }
     if (shmId == -1) {
         //printf("shmget failed: %s\n", strerror(errno));
         return 1;
@@ -601,8 +3185,17 @@ int main() {
         return 1;
     }
 
-    int solverMqIds[250];
+    const char *backend = getenv("SOLVER_BACKEND");
+    solverSocketBackend = (backend != NULL && strcmp(backend, "socket") == 0);
+    const char *packed = getenv("SOLVER_PACKED");
+    solverPacked = (packed != NULL && strcmp(packed, "1") == 0);
+
+    int solverMqIds[MAX_SOLVERS];
     for (int i = 0; i < S; i++) {
+        if (solverSocketBackend) {
+            solverMqIds[i] = solverKeys[i];   // already an open descriptor
+            continue;
+        }
         solverMqIds[i] = msgget((key_t)solverKeys[i], 0);
         if (solverMqIds[i] == -1) {
             //printf("msgget(solver %d) failed: %s\n", i, strerror(errno));
@@ -611,17 +3204,32 @@ int main() {
     }
     
     
+    static TruckInfo trucks[MAX_TRUCKS];
+    fleet_init();
+    fleet_select_kernel();
+    params_load();
+    initTruckInfo(D, trucks);
+    oracle_init(N);
+    demand_init(N, T);
+    zones_init(N);
+    log_open();
+    prof_open();
+
     while (1) {
     TurnChangeResponse turnMsg;
 
     ssize_t r = msgrcv(mainMqId,&turnMsg,sizeof(TurnChangeResponse) - sizeof(long),2,0);
     if (r == -1) {
         printf("msgrcv failed: %s\n", strerror(errno));
+        log_close();
+        prof_close();
         return 1;
     }
 
-    printf("Turn %d: newPackageRequestCount = %d\n",
-           turnMsg.turnNumber, turnMsg.newPackageRequestCount);
+    PROF_LAP(PH_WAIT);
+
+    logTurn = turnMsg.turnNumber;
+    LOG_INFO(EV_TURN, -1, turnMsg.newPackageRequestCount);
 
     // store count for this turn
     int newCount = turnMsg.newPackageRequestCount;
@@ -646,18 +3254,40 @@ int main() {
 
     allPackages[id].used = 1;
     allPackages[id].assignedToTruck = -1;
+    allPackages[id].delivered = 0;
+    allPackages[id].relayLeg = 0;
+    allPackages[id].relays = 0;
+    allPackages[id].droppedTurn = -1;
     allPackages[id].pkg = p;
+    mark_package_dirty(&allPackages[id]);
 
     unassignedIds[unassignedCount++] = id;
+    demand_record(p.pickup_x, p.pickup_y, turnMsg.turnNumber);
 
-    printf("New package %d -> pickup(%d,%d) drop(%d,%d)\n",
-           id, p.pickup_x, p.pickup_y,
-           p.dropoff_x, p.dropoff_y);
+    LOG_INFO(EV_NEW_PACKAGE, -1, id, p.pickup_x, p.pickup_y,
+             p.dropoff_x, p.dropoff_y);
         }
         
-    TruckInfo trucks[MAX_TRUCKS];
+    PROF_LAP(PH_INGEST);
+
+    learn_tolls(mainShmPtr, D, trucks);
+    sync_relay_locations(mainShmPtr);
+    oracle_new_turn();
+    PROF_LAP(PH_ORACLE);
     readTruckInfo(mainShmPtr, D, trucks);
-    assignPackagesToTrucks(trucks, D);
+    PROF_LAP(PH_READ);
+    triagePackages(trucks, D, turnMsg.turnNumber);
+    PROF_LAP(PH_TRIAGE);
+    assignPackagesToTrucks(trucks, D, turnMsg.turnNumber);
+    PROF_LAP(PH_ASSIGN);
+    plan_idle_repositioning(trucks, D, turnMsg.turnNumber);
+    PROF_LAP(PH_REPOSITION);
+    if (planEvents > 0 || turnMsg.turnNumber - lastRolloutTurn >= ROLLOUT_REFRESH) {
+        routePolicy = choose_route_policy(trucks, D, turnMsg.turnNumber);
+        lastRolloutTurn = turnMsg.turnNumber;
+        planEvents = 0;
+    }
+    PROF_LAP(PH_ROLLOUT);
     
     
     decide_truck_actions(D,
@@ -665,7 +3295,25 @@ int main() {
                      allPackages,
                      mainShmPtr->truckMovementInstructions, 
                      mainShmPtr->pickUpCommands,
-                     mainShmPtr->dropOffCommands);
+                     mainShmPtr->dropOffCommands,
+                     turnMsg.turnNumber);
+    PROF_LAP(PH_DECIDE);
+
+    fill_auth_strings(mainShmPtr, D, S, solverMqIds);
+    PROF_LAP(PH_AUTH);
+
+    queue_turn_plan(mainShmPtr, D, trucks, turnMsg.turnNumber, T);
+
+    TurnReadyRequest ready;
+    ready.mtype = 1;
+    if (msgsnd(mainMqId, &ready, sizeof(TurnReadyRequest) - sizeof(long), 0) == -1) {
+        printf("msgsnd (turn ready) failed: %s\n", strerror(errno));
+        log_close();
+        prof_close();
+        return 1;
+    }
+    PROF_LAP(PH_REPLY);
+    prof_turn_done();
 
 
 
@@ -673,5 +3321,8 @@ int main() {
    
    
 
+    log_close();
+    prof_close();
     return 0;
-}
\ No newline at end of file
+}
+#endif
@@ -0,0 +1,145 @@
+import argparse
+import math
+import os
+import random
+import shutil
+import tempfile
+from concurrent.futures import ThreadPoolExecutor
+
+from run_parallel import TURNS_RE, run_helper
+
+# Tunes the planner parameters solution.c reads from SOLUTION_PARAMS, one
+# workload class at a time, by successive halving. Random configurations
+# (plus the built-in defaults) are run on a few workloads the helper
+# generates itself (-g); the better half goes on to twice as many seeds,
+# and so on until one configuration is left. Every run sees the same seeds
+# at a given rung, so configurations are compared on identical workloads.
+# The winner of each class is written to OUT_DIR/<class>.params.
+
+# name: (low, high, integer, default)
+PARAMS = {
+    "batch_size": (2, 40, True, 10),
+    "max_capacity": (2, 20, True, 5),
+    "near_radius": (1, 12, True, 4),
+    "loaded_radius": (1, 12, True, 3),
+    "loaded_above": (0, 10, True, 2),
+    "align_cosine": (0.0, 1.0, False, 0.7),
+    "aligned_limit": (0, 12, True, 4),
+    "other_limit": (0, 12, True, 2),
+}
+
+# name: helper -g arguments N D S T B maxNewPerTurn requests maxBoothCost
+CLASSES = {
+    "small": (40, 20, 8, 200, 20, 5, 300, 5),
+    "medium": (100, 50, 20, 400, 40, 20, 3000, 10),
+    "large": (200, 100, 20, 1000, 80, 10, 1500, 20),
+}
+
+
+def random_config(rng):
+    config = {}
+    for name, (low, high, integer, _) in PARAMS.items():
+        config[name] = rng.randint(low, high) if integer else round(rng.uniform(low, high), 3)
+    return config
+
+
+def write_params(path, config, comment=None):
+    with open(path, "w") as file:
+        if comment:
+            file.write(f"# {comment}\n")
+        for name in PARAMS:
+            file.write(f"{name} {config[name]}\n")
+
+
+def run_workload(shape, seed, params_path, args):
+    """Score of one generated run, or None if it failed."""
+    run_dir = tempfile.mkdtemp(prefix=f"tune-{seed}-", dir=args.work_dir)
+    env = dict(os.environ, SOLUTION_BIN=os.path.abspath(args.solution), SOLUTION_PARAMS=params_path)
+    command = [os.path.abspath(args.helper), "-g", *map(str, shape), str(seed)]
+    output = run_helper(command, run_dir, env, args.timeout)
+    shutil.rmtree(run_dir, ignore_errors=True)
+
+    turns = TURNS_RE.search(output)
+    if turns is None or "successfully complete" not in output:
+        return None
+    return int(turns.group(1)) + args.expired_weight * int(turns.group(2))
+
+
+def tune_class(name, shape, pool, args):
+    rng = random.Random(f"{args.seed}-{name}")
+    configs = [{n: spec[3] for n, spec in PARAMS.items()}]
+    configs += [random_config(rng) for _ in range(args.configs - 1)]
+    seeds = [rng.randrange(1, 1 << 30) for _ in range(args.seeds << math.ceil(math.log2(args.configs)))]
+
+    param_dir = tempfile.mkdtemp(prefix=f"params-{name}-", dir=args.work_dir)
+    paths = []
+    for i, config in enumerate(configs):
+        paths.append(os.path.join(param_dir, f"{i}.params"))
+        write_params(paths[-1], config)
+
+    scores = {}  # (config, seed) -> score
+    alive = list(range(len(configs)))
+    budget = args.seeds
+    while True:
+        jobs = {(c, s): pool.submit(run_workload, shape, s, paths[c], args)
+                for c in alive for s in seeds[:budget] if (c, s) not in scores}
+        for key, future in jobs.items():
+            scores[key] = future.result()
+
+        def mean(c):
+            runs = [scores[(c, s)] for s in seeds[:budget]]
+            return math.inf if None in runs else sum(runs) / len(runs)
+
+        alive.sort(key=mean)
+        defaults = f" (defaults {mean(0):.1f})" if 0 in alive else ""
+        print(f"{name}: {len(alive)} configs on {budget} seeds, best mean score {mean(alive[0]):.1f}{defaults}",
+              flush=True)
+        if len(alive) == 1:
+            break
+        alive = alive[:max(1, len(alive) // 2)]
+        budget *= 2
+
+    best = alive[0]
+    shutil.rmtree(param_dir, ignore_errors=True)
+    return configs[best], mean(best), budget
+
+
+def main():
+    parser = argparse.ArgumentParser(description="Tune solution planner parameters per workload class.")
+    parser.add_argument("--helper", default="./helper", help="helper binary")
+    parser.add_argument("--solution", default="./solution", help="solution binary")
+    parser.add_argument("--class", dest="classes", action="append", metavar="NAME=N,D,S,T,B,NEW,REQ,BOOTH",
+                        help="workload class to tune (repeatable; default: the built-in classes)")
+    parser.add_argument("--configs", type=int, default=16, help="configurations tried per class")
+    parser.add_argument("--seeds", type=int, default=2, help="seeds per configuration at the first rung")
+    parser.add_argument("--expired-weight", type=float, default=10,
+                        help="score = turns + weight * expired packages")
+    parser.add_argument("--seed", type=int, default=1, help="seed of the search itself")
+    parser.add_argument("-j", "--jobs", type=int, default=os.cpu_count(), help="concurrent runs")
+    parser.add_argument("--work-dir", default="tune-runs", help="parent of the per-run directories")
+    parser.add_argument("--out-dir", default="tuned", help="where <class>.params files go")
+    parser.add_argument("--timeout", type=float, default=600, help="seconds per run")
+    args = parser.parse_args()
+
+    classes = CLASSES
+    if args.classes:
+        classes = {}
+        for spec in args.classes:
+            name, _, shape = spec.partition("=")
+            classes[name] = tuple(int(v) for v in shape.split(",")) if shape else CLASSES[name]
+            if len(classes[name]) != 8:
+                parser.error(f"class {name} needs 8 generator arguments")
+
+    os.makedirs(args.work_dir, exist_ok=True)
+    os.makedirs(args.out_dir, exist_ok=True)
+    with ThreadPoolExecutor(max_workers=args.jobs) as pool:
+        for name, shape in classes.items():
+            config, score, seeds = tune_class(name, shape, pool, args)
+            path = os.path.join(args.out_dir, f"{name}.params")
+            write_params(path, config, f"{name} {' '.join(map(str, shape))}: "
+                                       f"mean score {score:.1f} over {seeds} seeds")
+            print(f"{name}: wrote {path}")
+
+
+if __name__ == "__main__":
+    main()